@@ -0,0 +1,130 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "arrival.h"
+#include <math.h>
+#include <stdlib.h>
+#include <sys/timerfd.h>
+#include "common.h"
+
+/* Pending arrivals kept per thread, about 16 MiB worth of timestamps. */
+#define ARRIVALS_QUEUE_LEN (1 << 20)
+
+struct arrivals {
+        int fd;
+        double rate;
+        bool poisson;
+        unsigned short xsubi[3];        /* erand48() state */
+        struct timespec next;           /* next arrival not queued yet */
+        struct timespec *queue;         /* ring buffer */
+        unsigned int head, tail;
+        unsigned long missed;
+        struct callbacks *cb;
+};
+
+static double next_gap(struct arrivals *a)
+{
+        if (!a->poisson)
+                return 1 / a->rate;
+        /* erand48() is in [0, 1), keep the logarithm finite */
+        return -log(1 - erand48(a->xsubi)) / a->rate;
+}
+
+static void arm_timer(struct arrivals *a)
+{
+        struct itimerspec its = { .it_value = a->next };
+
+        if (timerfd_settime(a->fd, TFD_TIMER_ABSTIME, &its, NULL))
+                PLOG_FATAL(a->cb, "timerfd_settime");
+}
+
+struct arrivals *arrivals_create(double rate, bool poisson, unsigned int seed,
+                                 struct callbacks *cb)
+{
+        struct arrivals *a;
+
+        a = calloc(1, sizeof(*a));
+        if (!a)
+                PLOG_FATAL(cb, "calloc arrivals");
+        a->queue = calloc(ARRIVALS_QUEUE_LEN, sizeof(a->queue[0]));
+        if (!a->queue)
+                PLOG_FATAL(cb, "calloc arrivals queue");
+        a->rate = rate;
+        a->poisson = poisson;
+        a->xsubi[0] = 0x330e;
+        a->xsubi[1] = seed;
+        a->xsubi[2] = seed >> 16;
+        a->cb = cb;
+
+        a->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (a->fd == -1)
+                PLOG_FATAL(cb, "timerfd_create");
+        return a;
+}
+
+void arrivals_start(struct arrivals *a)
+{
+        clock_gettime(CLOCK_MONOTONIC, &a->next);
+        timespec_add(&a->next, next_gap(a));
+        arm_timer(a);
+}
+
+void arrivals_destroy(struct arrivals *a)
+{
+        if (!a)
+                return;
+        do_close(a->fd);
+        free(a->queue);
+        free(a);
+}
+
+int arrivals_fd(struct arrivals *a)
+{
+        return a->fd;
+}
+
+void arrivals_update(struct arrivals *a)
+{
+        struct timespec now;
+        uint64_t expirations;
+
+        if (read(a->fd, &expirations, sizeof(expirations)) == -1 &&
+            errno != EAGAIN)
+                PLOG_ERROR(a->cb, "read timerfd");
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        while (timespec_cmp(&a->next, &now) <= 0) {
+                if (a->tail - a->head < ARRIVALS_QUEUE_LEN)
+                        a->queue[a->tail++ % ARRIVALS_QUEUE_LEN] = a->next;
+                else
+                        a->missed++;
+                timespec_add(&a->next, next_gap(a));
+        }
+        arm_timer(a);
+}
+
+bool arrivals_pop(struct arrivals *a, struct timespec *intended)
+{
+        if (a->head == a->tail)
+                return false;
+        *intended = a->queue[a->head++ % ARRIVALS_QUEUE_LEN];
+        return true;
+}
+
+unsigned long arrivals_missed(struct arrivals *a)
+{
+        return a->missed;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NEPER_ARRIVAL_H
+#define NEPER_ARRIVAL_H
+
+/*
+ * Open-loop request schedule. Arrivals are generated at a fixed average
+ * rate, independent of how fast they get served, and queued until a flow
+ * picks them up. A timerfd fires at the next arrival so the schedule can
+ * be driven from an epoll loop.
+ */
+
+#include <stdbool.h>
+#include <time.h>
+
+struct callbacks;
+struct arrivals;
+
+/* @rate is in arrivals per second. With @poisson the gaps between arrivals
+ * are exponentially distributed, otherwise they are all 1 / @rate. */
+struct arrivals *arrivals_create(double rate, bool poisson, unsigned int seed,
+                                 struct callbacks *cb);
+void arrivals_destroy(struct arrivals *a);
+
+/* Start the schedule, the first arrival is due one gap from now. Until
+ * then the timer stays disarmed. */
+void arrivals_start(struct arrivals *a);
+
+/* File descriptor that turns readable once the next arrival is due. */
+int arrivals_fd(struct arrivals *a);
+
+/* Queue the arrivals due by now and rearm the timer for the next one. */
+void arrivals_update(struct arrivals *a);
+
+/* Take the oldest queued arrival. Returns false if there is none. */
+bool arrivals_pop(struct arrivals *a, struct timespec *intended);
+
+/* Number of arrivals dropped because the queue was full. */
+unsigned long arrivals_missed(struct arrivals *a);
+
+#endif
@@ -17,8 +17,10 @@
 #include <assert.h>
 #include <ctype.h>
 #include <fcntl.h>
+#include <linux/filter.h>
 #include <math.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <string.h>
 #include <unistd.h>
 #include "common.h"
@@ -149,6 +151,23 @@ void set_reuseport(int fd, struct callbacks *cb)
                 PLOG_ERROR(cb, "setsockopt(SO_REUSEPORT)");
 }
 
+/* Pick the socket of the SO_REUSEPORT group of @fd by the index that the
+ * classic BPF program @code returns. */
+void set_reuseport_cbpf(int fd, struct sock_filter *code, int len,
+                        struct callbacks *cb)
+{
+        struct sock_fprog prog = {
+                .len = len,
+                .filter = code,
+        };
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+        if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+                       sizeof(prog)))
+                PLOG_ERROR(cb, "setsockopt(SO_ATTACH_REUSEPORT_CBPF)");
+}
+
 void set_reuseaddr(int fd, int on, struct callbacks *cb)
 {
         if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)))
@@ -180,6 +199,71 @@ void set_debug(int fd, int onoff, struct callbacks *cb)
                 PLOG_ERROR(cb, "setsockopt(SO_DEBUG)");
 }
 
+void set_zerocopy(int fd, int on, struct callbacks *cb)
+{
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+        if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)))
+                PLOG_ERROR(cb, "setsockopt(SO_ZEROCOPY)");
+}
+
+void set_udp_segment(int fd, int gso_size, struct callbacks *cb)
+{
+        if (setsockopt(fd, SOL_UDP, UDP_SEGMENT, &gso_size, sizeof(gso_size)))
+                PLOG_ERROR(cb, "setsockopt(UDP_SEGMENT)");
+}
+
+void set_udp_gro(int fd, int on, struct callbacks *cb)
+{
+        if (setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on)))
+                PLOG_ERROR(cb, "setsockopt(UDP_GRO)");
+}
+
+void set_nodelay(int fd, int on, struct callbacks *cb)
+{
+        if (setsockopt(fd, SOL_TCP, TCP_NODELAY, &on, sizeof(on)))
+                PLOG_ERROR(cb, "setsockopt(TCP_NODELAY)");
+}
+
+void set_fastopen(int fd, int qlen, struct callbacks *cb)
+{
+        if (setsockopt(fd, SOL_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen)))
+                PLOG_ERROR(cb, "setsockopt(TCP_FASTOPEN)");
+}
+
+void set_fastopen_connect(int fd, int on, struct callbacks *cb)
+{
+#ifndef TCP_FASTOPEN_CONNECT
+#define TCP_FASTOPEN_CONNECT 30
+#endif
+        if (setsockopt(fd, SOL_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on)))
+                PLOG_ERROR(cb, "setsockopt(TCP_FASTOPEN_CONNECT)");
+}
+
+void set_bind_no_port(int fd, int on, struct callbacks *cb)
+{
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+        if (setsockopt(fd, SOL_IP, IP_BIND_ADDRESS_NO_PORT, &on, sizeof(on)))
+                PLOG_ERROR(cb, "setsockopt(IP_BIND_ADDRESS_NO_PORT)");
+}
+
+void set_linger(int fd, int onoff, int seconds, struct callbacks *cb)
+{
+        struct linger l = { .l_onoff = onoff, .l_linger = seconds };
+
+        if (setsockopt(fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l)))
+                PLOG_ERROR(cb, "setsockopt(SO_LINGER)");
+}
+
+void set_timestamping(int fd, int flags, struct callbacks *cb)
+{
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)))
+                PLOG_ERROR(cb, "setsockopt(SO_TIMESTAMPING)");
+}
+
 void set_nonblocking(int fd, struct callbacks *cb)
 {
         int flags = fcntl(fd, F_GETFL, 0);
@@ -267,7 +351,23 @@ ssize_t do_write(struct script_slave *ss, int sockfd, char *buf, size_t len,
 
         n = script_slave_sendmsg_hook(ss, sockfd, &msg, flags);
         if (n == -EHOOKEMPTY)
-                n = write(sockfd, buf, len);
+                n = flags ? send(sockfd, buf, len, flags) :
+                            write(sockfd, buf, len);
+        else if (n < 0)
+                errno = -n;
+
+        return n < 0 ? -1 : n;
+}
+
+/* Like do_write() but lets the caller pass a destination and control data. */
+ssize_t do_sendmsg(struct script_slave *ss, int sockfd, struct msghdr *msg,
+                   int flags)
+{
+        ssize_t n;
+
+        n = script_slave_sendmsg_hook(ss, sockfd, msg, flags);
+        if (n == -EHOOKEMPTY)
+                n = sendmsg(sockfd, msg, flags);
         else if (n < 0)
                 errno = -n;
 
@@ -301,12 +401,26 @@ ssize_t do_read(struct script_slave *ss, int sockfd, char *buf, size_t len,
         return n < 0 ? -1 : n;
 }
 
+/* Like do_read() but lets the caller look at the control messages. */
+ssize_t do_recvmsg(struct script_slave *ss, int sockfd, struct msghdr *msg,
+                   int flags)
+{
+        ssize_t n;
+
+        n = script_slave_recvmsg_hook(ss, sockfd, msg, flags);
+        if (n == -EHOOKEMPTY)
+                n = recvmsg(sockfd, msg, flags);
+        else if (n < 0)
+                errno = -n;
+
+        return n < 0 ? -1 : n;
+}
+
 ssize_t do_readerr(struct script_slave *ss, int sockfd, char *buf, size_t len,
                    int flags)
 {
         /* XXX: Make cmsg buffer size configurable through opts? */
         uint8_t cbuf[512];
-        ssize_t n;
 
         struct iovec iov = {
                 .iov_base = buf,
@@ -319,10 +433,19 @@ ssize_t do_readerr(struct script_slave *ss, int sockfd, char *buf, size_t len,
                 .msg_controllen = ARRAY_SIZE(cbuf),
         };
 
+        return do_recverr(ss, sockfd, &msg, flags);
+}
+
+/* Like do_readerr() but lets the caller look at the control messages. */
+ssize_t do_recverr(struct script_slave *ss, int sockfd, struct msghdr *msg,
+                   int flags)
+{
+        ssize_t n;
+
         flags |= MSG_ERRQUEUE;
-        n = script_slave_recverr_hook(ss, sockfd, &msg, flags);
+        n = script_slave_recverr_hook(ss, sockfd, msg, flags);
         if (n == -EHOOKEMPTY)
-                n = recv(sockfd, buf, len, flags);
+                n = recvmsg(sockfd, msg, flags);
         else if (n < 0)
                 errno = -n;
 
@@ -399,6 +522,14 @@ void parse_all_samples(char *arg, void *out, struct callbacks *cb)
                 *(const char **)out = "samples.csv";
 }
 
+void parse_live(char *arg, void *out, struct callbacks *cb)
+{
+        if (arg)
+                *(const char **)out = arg;
+        else
+                *(const char **)out = LIVE_STDERR;
+}
+
 void parse_max_pacing_rate(char *arg, void *out, struct callbacks *cb)
 {
         *(long long *)out = parse_rate(arg, cb);
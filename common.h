@@ -36,6 +36,25 @@
 #define ARRAY_SIZE(a) (sizeof((a))/sizeof((a)[0]))
 #define UNUSED(x) ((void) (x))
 
+/* Counters written by one thread and read by others get lines of their own */
+#define CACHELINE_SIZE 64
+
+/* UDP GSO/GRO, for C libraries that predate them */
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+/* Segments the kernel takes at most in one UDP_SEGMENT send */
+#define GSO_MAX_SEGMENTS 64
+
+/* Where --live goes without a file name, away from the results on stdout */
+#define LIVE_STDERR "/dev/stderr"
+
 /* Walk over a list of structures linked through a 'next' field.
  * Safe for use when removing an element from the list. */
 #define LIST_FOR_EACH(head, iter) \
@@ -45,6 +64,7 @@
 
 
 struct script_slave;
+struct sock_filter;
 
 struct byte_array {
         uint8_t *data;
@@ -81,6 +101,27 @@ static inline double seconds_between(struct timespec *a, struct timespec *b)
         return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) * 1e-9;
 }
 
+static inline void timespec_add(struct timespec *ts, double seconds)
+{
+        long ns = ts->tv_nsec + (long) (seconds * 1e9);
+
+        ts->tv_sec += ns / 1000000000;
+        ts->tv_nsec = ns % 1000000000;
+        if (ts->tv_nsec < 0) {
+                ts->tv_sec--;
+                ts->tv_nsec += 1000000000;
+        }
+}
+
+static inline int timespec_cmp(const struct timespec *a, const struct timespec *b)
+{
+        if (a->tv_sec != b->tv_sec)
+                return a->tv_sec < b->tv_sec ? -1 : 1;
+        if (a->tv_nsec != b->tv_nsec)
+                return a->tv_nsec < b->tv_nsec ? -1 : 1;
+        return 0;
+}
+
 static inline int flows_in_thread(int num_flows, int num_threads, int tid)
 {
         const int min_flows_per_thread = num_flows / num_threads;
@@ -99,12 +140,23 @@ struct addrinfo *do_getaddrinfo(const char *host, const char *port, int flags,
                                 struct callbacks *cb);
 long long parse_rate(const char *str, struct callbacks *cb);
 void set_reuseport(int fd, struct callbacks *cb);
+void set_reuseport_cbpf(int fd, struct sock_filter *code, int len,
+                        struct callbacks *cb);
 void set_nonblocking(int fd, struct callbacks *cb);
 void set_reuseaddr(int fd, int on, struct callbacks *cb);
 void set_debug(int fd, int onoff, struct callbacks *cb);
 void set_max_pacing_rate(int fd, uint32_t max_pacing_rate, struct callbacks *cb);
 void set_min_rto(int fd, int min_rto_ms, struct callbacks *cb);
 void set_local_host(int fd, struct options *opt, struct callbacks *cb);
+void set_zerocopy(int fd, int on, struct callbacks *cb);
+void set_udp_segment(int fd, int gso_size, struct callbacks *cb);
+void set_udp_gro(int fd, int on, struct callbacks *cb);
+void set_nodelay(int fd, int on, struct callbacks *cb);
+void set_fastopen(int fd, int qlen, struct callbacks *cb);
+void set_fastopen_connect(int fd, int on, struct callbacks *cb);
+void set_bind_no_port(int fd, int on, struct callbacks *cb);
+void set_linger(int fd, int onoff, int seconds, struct callbacks *cb);
+void set_timestamping(int fd, int flags, struct callbacks *cb);
 int procfile_int(const char *path, struct callbacks *cb);
 
 void fill_random(char *buf, int size);
@@ -112,15 +164,22 @@ int do_close(int fd);
 int do_connect(int s, const struct sockaddr *addr, socklen_t addr_len);
 ssize_t do_write(struct script_slave *ss, int sockfd, char *buf, size_t len,
                  int flags);
+ssize_t do_sendmsg(struct script_slave *ss, int sockfd, struct msghdr *msg,
+                   int flags);
 ssize_t do_read(struct script_slave *ss, int sockfd, char *buf, size_t len,
                 int flags);
 ssize_t do_readerr(struct script_slave *ss, int sockfd, char *buf, size_t len,
                    int flags);
+ssize_t do_recvmsg(struct script_slave *ss, int sockfd, struct msghdr *msg,
+                   int flags);
+ssize_t do_recverr(struct script_slave *ss, int sockfd, struct msghdr *msg,
+                   int flags);
 struct addrinfo *copy_addrinfo(struct addrinfo *in);
 void reset_port(struct addrinfo *ai, int port, struct callbacks *cb);
 int try_connect(const char *host, const char *port, struct addrinfo **ai,
                 struct options *opts, struct callbacks *cb);
 void parse_all_samples(char *arg, void *out, struct callbacks *cb);
+void parse_live(char *arg, void *out, struct callbacks *cb);
 void parse_max_pacing_rate(char *arg, void *out, struct callbacks *cb);
 
 int create_suicide_timeout(int sec_to_suicide);
@@ -15,6 +15,7 @@
  */
 
 #include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -68,3 +69,76 @@ int get_cpuinfo(struct cpuinfo *cpus, int max_cpus)
         fclose(f);
         return n;
 }
+
+int parse_cpulist(const char *list, cpu_set_t *set)
+{
+        long first, last;
+        char *end;
+
+        CPU_ZERO(set);
+        for (;;) {
+                first = strtol(list, &end, 10);
+                if (end == list || first < 0)
+                        goto invalid;
+                last = first;
+                if (*end == '-') {
+                        list = end + 1;
+                        last = strtol(list, &end, 10);
+                        if (end == list || last < first)
+                                goto invalid;
+                }
+                if (last >= CPU_SETSIZE)
+                        goto invalid;
+                for (; first <= last; first++)
+                        CPU_SET(first, set);
+                if (*end != ',')
+                        break;
+                list = end + 1;
+        }
+        if (*ltrim(end))
+                goto invalid;
+        return 0;
+invalid:
+        errno = EINVAL;
+        return -1;
+}
+
+/* Read the first line of sysfs file @path into @buf. */
+static int read_line(const char *path, char *buf, int size)
+{
+        FILE *f;
+
+        f = fopen(path, "r");
+        if (!f)
+                return -1;
+        if (!fgets(buf, size, f)) {
+                fclose(f);
+                errno = EIO;
+                return -1;
+        }
+        fclose(f);
+        return 0;
+}
+
+int get_node_cpus(int node, cpu_set_t *set)
+{
+        char path[64], buf[4096];
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+                 node);
+        if (read_line(path, buf, sizeof(buf)))
+                return -1;
+        return parse_cpulist(buf, set);
+}
+
+int get_netdev_node(const char *ifname)
+{
+        char path[128], buf[16];
+
+        snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node",
+                 ifname);
+        if (read_line(path, buf, sizeof(buf)))
+                return -1;
+        errno = 0;
+        return atoi(buf);
+}
@@ -17,6 +17,8 @@
 #ifndef NEPER_CPUINFO_H
 #define NEPER_CPUINFO_H
 
+#include <sched.h>
+
 struct cpuinfo {
         int processor;
         int physical_id;
@@ -32,4 +34,20 @@ struct cpuinfo {
  */
 int get_cpuinfo(struct cpuinfo *cpus, int max_cpus);
 
+/* Parse a list of CPUs such as "0-3,8,10-11" into @set.  Returns 0 on
+ * success, -1 with errno set to EINVAL if @list is malformed.
+ */
+int parse_cpulist(const char *list, cpu_set_t *set);
+
+/* Get the CPUs of NUMA node @node from sysfs.  Returns 0 on success,
+ * otherwise -1 with errno set.
+ */
+int get_node_cpus(int node, cpu_set_t *set);
+
+/* Get the NUMA node the device behind network interface @ifname is attached
+ * to, from sysfs.  Returns -1 if the platform doesn't tell, and -1 with errno
+ * set if the interface has no device, like virtual ones.
+ */
+int get_netdev_node(const char *ifname);
+
 #endif
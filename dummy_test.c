@@ -221,9 +221,9 @@ static void *worker_thread(void *arg)
         reset_port(t->ai, atoi(opts->port), t->cb);
 
         if (opts->client)
-                run_client(t, &fake_socket_ops, client_events);
+                run_client(t, &fake_socket_ops, client_events, NULL);
         else
-                run_server(t, &fake_socket_ops, server_events);
+                run_server(t, &fake_socket_ops, server_events, NULL);
 
         return NULL;
 }
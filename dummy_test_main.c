@@ -63,6 +63,10 @@ int main(int argc, char **argv)
         DEFINE_FLAG(fp, bool,         ipv6,          false,   '6', "Set desired address family to AF_INET6");
         DEFINE_FLAG(fp, bool,         client,        false,   'c', "Is client?");
         DEFINE_FLAG(fp, bool,         pin_cpu,       false,   'U', "Pin threads to CPU cores");
+        DEFINE_FLAG(fp, const char *, cpu_list,      NULL,     0,  "Pin worker threads to these CPUs, e.g. 2-9,18-25");
+        DEFINE_FLAG(fp, int,          main_cpu,      -1,       0,  "Pin the main thread to this CPU, off the workers' CPUs");
+        DEFINE_FLAG(fp, int,          numa_node,     -1,       0,  "Run threads on this NUMA node and allocate from it");
+        DEFINE_FLAG(fp, const char *, numa_netdev,   NULL,     0,  "Run threads on the NUMA node of this network interface");
         DEFINE_FLAG(fp, bool,         logtostderr,   false,   'V', "Log to stderr");
         DEFINE_FLAG(fp, bool,         nonblocking,   false,    0,  "Make sure syscalls are all nonblocking");
         DEFINE_FLAG(fp, const char *, local_host,    NULL,    'L', "Local hostname or IP address");
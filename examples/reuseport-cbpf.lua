@@ -3,6 +3,9 @@
 -- https://git.kernel.org/pub/scm/linux/kernel/git/torvalds/linux.git/tree/tools/testing/selftests/net/reuseport_bpf_cpu.c
 -- https://github.com/cloudflare/cloudflare-blog/blob/master/2017-11-perfect-locality/setcbpf.stp
 --
+-- The --reuseport-cpu option does this without a script, sizing the group
+-- to the number of threads and indexing it by the CPUs they run on.
+--
 
 -- XXX_1: Will be gone. Need to extend ljsyscall. We are missing constants. Ignore for now.
 local SKF_AD_OFF              = -0x1000
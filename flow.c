@@ -16,10 +16,10 @@
 
 #include "flow.h"
 #include "common.h"
+#include "histogram.h"
 #include "interval.h"
 #include "lib.h"
 #include "logging.h"
-#include "numlist.h"
 
 /**
  * Creates a lite flow that wraps a file descriptor to monitor for events.
@@ -41,6 +41,46 @@ struct flow *addflow_lite(int epfd, int fd, uint32_t events,
         return flow;
 }
 
+/**
+ * Creates a flow that is not registered with any epoll set. Used by event
+ * loops that don't rely on readiness notifications (io_uring).
+ *
+ * Caller releases the flow using flow_destroy().
+ */
+struct flow *flow_create(int tid, int fd, int flow_id, struct callbacks *cb)
+{
+        struct flow *flow;
+
+        flow = calloc(1, sizeof(struct flow));
+        if (!flow)
+                PLOG_FATAL(cb, "calloc flow");
+        flow->fd = fd;
+        flow->id = flow_id;
+        flow->latency = histogram_create(cb);
+
+        LOG_INFO(cb, "tid=%d, flow_id=%d", tid, flow->id);
+        return flow;
+}
+
+/**
+ * Closes the flow's socket and releases the flow.
+ */
+void flow_destroy(int tid, struct flow *flow, struct callbacks *cb)
+{
+        interval_destroy(flow->itv);
+        if (!flow->thread_latency) {
+                histogram_destroy(flow->latency);
+                if (flow->connect_latency)
+                        histogram_destroy(flow->connect_latency);
+                if (flow->first_byte_latency)
+                        histogram_destroy(flow->first_byte_latency);
+        }
+        free(flow->priv);
+        do_close(flow->fd);
+        LOG_INFO(cb, "tid=%d, flow_id=%d", tid, flow->id);
+        free(flow);
+}
+
 struct flow *addflow(int tid, int epfd, int fd, int flow_id, uint32_t events,
                      struct callbacks *cb)
 {
@@ -49,25 +89,55 @@ struct flow *addflow(int tid, int epfd, int fd, int flow_id, uint32_t events,
 
         set_nonblocking(fd, cb);
 
+        flow = flow_create(tid, fd, flow_id, cb);
+
+        ev.events = EPOLLRDHUP | events;
+        ev.data.ptr = flow;
+        epoll_ctl_or_die(epfd, EPOLL_CTL_ADD, fd, &ev, cb);
+
+        return flow;
+}
+
+void delflow(int tid, int epfd, struct flow *flow, struct callbacks *cb)
+{
+        epoll_del_or_err(epfd, flow->fd, cb);
+        flow_destroy(tid, flow, cb);
+}
+
+/**
+ * Creates a flow for a connection that lives for a single transaction, like
+ * addflow() but without a latency histogram and without logging, which
+ * would cost more than the transaction itself.
+ *
+ * Caller releases the flow using delflow_oneshot().
+ */
+struct flow *addflow_oneshot(int epfd, int fd, int flow_id, uint32_t events,
+                             struct callbacks *cb)
+{
+        struct epoll_event ev;
+        struct flow *flow;
+
+        set_nonblocking(fd, cb);
+
         flow = calloc(1, sizeof(struct flow));
+        if (!flow)
+                PLOG_FATAL(cb, "calloc flow");
         flow->fd = fd;
         flow->id = flow_id;
-        flow->latency = numlist_create(cb);
 
         ev.events = EPOLLRDHUP | events;
         ev.data.ptr = flow;
         epoll_ctl_or_die(epfd, EPOLL_CTL_ADD, fd, &ev, cb);
 
-        LOG_INFO(cb, "tid=%d, flow_id=%d", tid, flow->id);
         return flow;
 }
 
-void delflow(int tid, int epfd, struct flow *flow, struct callbacks *cb)
+/**
+ * Closes the socket of a flow created by addflow_oneshot(), which also
+ * drops it from the epoll set, and releases the flow.
+ */
+void delflow_oneshot(struct flow *flow)
 {
-        interval_destroy(flow->itv);
-        numlist_destroy(flow->latency);
-        epoll_del_or_err(epfd, flow->fd, cb);
         do_close(flow->fd);
-        LOG_INFO(cb, "tid=%d, flow_id=%d", tid, flow->id);
         free(flow);
 }
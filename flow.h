@@ -17,12 +17,13 @@
 #ifndef NEPER_FLOW_H
 #define NEPER_FLOW_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <sys/types.h>
 
 struct callbacks;
+struct histogram;
 struct interval;
-struct numlist;
 struct options;
 
 struct flow {
@@ -33,8 +34,15 @@ struct flow {
         ssize_t bytes_to_write;
         unsigned long transactions;
         struct timespec write_time;
-        struct numlist *latency;
+        struct histogram *latency;
+        struct histogram *connect_latency;      /* tcp_crr only */
+        struct histogram *first_byte_latency;   /* tcp_crr only */
+        bool thread_latency;    /* the histograms belong to the thread */
+        bool connecting;        /* waiting for a nonblocking connect() */
         struct interval *itv;
+        int uring_pending;      /* io_uring operations in flight */
+        bool uring_closing;     /* release once nothing is in flight */
+        void *priv;             /* the workload's own state, freed with it */
 };
 
 struct flow *addflow_lite(int epfd, int fd, uint32_t events,
@@ -42,5 +50,10 @@ struct flow *addflow_lite(int epfd, int fd, uint32_t events,
 struct flow *addflow(int tid, int epfd, int fd, int flow_id, uint32_t events,
                      struct callbacks *cb);
 void delflow(int tid, int epfd, struct flow *flow, struct callbacks *cb);
+struct flow *addflow_oneshot(int epfd, int fd, int flow_id, uint32_t events,
+                             struct callbacks *cb);
+void delflow_oneshot(struct flow *flow);
+struct flow *flow_create(int tid, int fd, int flow_id, struct callbacks *cb);
+void flow_destroy(int tid, struct flow *flow, struct callbacks *cb);
 
 #endif
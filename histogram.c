@@ -0,0 +1,279 @@
+/*
+ * Copyright 2018 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "histogram.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib.h"
+#include "logging.h"
+#include "numlist.h"
+
+/* Values are tracked up to 2^40 ns, some 18 minutes, larger ones count as
+ * that. */
+#define MAX_MAGNITUDE 40
+
+/* Bins are allocated this many at a time, on first use */
+#define CHUNK_BINS 64
+
+static int g_digits = 3;
+static bool g_keep_raw;
+
+struct histogram {
+        struct callbacks *cb;
+        int sub_bits;           /* log2 of the bins per power of two */
+        int n_bins;
+        uint64_t **chunks;      /* n_bins / CHUNK_BINS of them */
+        int lo, hi;             /* chunks allocated are all in [lo, hi) */
+        size_t count;
+        double min;
+        double max;
+        double mean;
+        double m2;              /* sum of squared deviations from mean */
+        struct numlist *raw;    /* every value, if asked to keep them */
+};
+
+void histogram_configure(int digits, bool keep_raw)
+{
+        g_digits = digits;
+        g_keep_raw = keep_raw;
+}
+
+static int n_chunks(const struct histogram *h)
+{
+        return (h->n_bins + CHUNK_BINS - 1) / CHUNK_BINS;
+}
+
+struct histogram *histogram_create(struct callbacks *cb)
+{
+        struct histogram *h;
+        long bins = 2;
+
+        h = calloc(1, sizeof(*h));
+        if (!h)
+                PLOG_FATAL(cb, "calloc histogram");
+        h->cb = cb;
+        /* Telling apart x and x + 10^-digits * x takes 2 * 10^digits bins
+         * between 2^k and 2^(k+1), of which only the upper half is used
+         * past the first power of two */
+        while (bins < 2 * pow(10, g_digits))
+                bins *= 2;
+        h->sub_bits = log2(bins);
+        h->n_bins = bins + (MAX_MAGNITUDE - h->sub_bits) * bins / 2;
+        h->chunks = calloc(n_chunks(h), sizeof(h->chunks[0]));
+        if (!h->chunks)
+                PLOG_FATAL(cb, "calloc histogram chunks");
+        h->lo = n_chunks(h);
+        h->min = INFINITY;
+        h->max = -INFINITY;
+        if (g_keep_raw)
+                h->raw = numlist_create(cb);
+        return h;
+}
+
+void histogram_destroy(struct histogram *h)
+{
+        int i;
+
+        for (i = h->lo; i < h->hi; i++)
+                free(h->chunks[i]);
+        free(h->chunks);
+        if (h->raw)
+                numlist_destroy(h->raw);
+        free(h);
+}
+
+/*
+ * Values below 2^sub_bits have a bin each. Past that, the values from 2^k
+ * to 2^(k+1) share 2^(sub_bits-1) bins, so the bins are 2^(k-sub_bits+1)
+ * wide.
+ */
+static int bin_of(const struct histogram *h, uint64_t ns)
+{
+        int msb, shift;
+
+        if (ns >> h->sub_bits == 0)
+                return ns;
+        msb = 63 - __builtin_clzll(ns);
+        shift = msb - h->sub_bits + 1;
+        return (1 << h->sub_bits) + ((shift - 1) << (h->sub_bits - 1)) +
+               (int) (ns >> shift) - (1 << (h->sub_bits - 1));
+}
+
+/* The largest value, in ns, that falls into bin @i. */
+static uint64_t bin_top(const struct histogram *h, int i)
+{
+        int half = 1 << (h->sub_bits - 1), shift;
+        uint64_t sub;
+
+        if (i < 2 * half)
+                return i;
+        i -= 2 * half;
+        shift = i / half + 1;
+        sub = i % half + half;
+        return ((sub + 1) << shift) - 1;
+}
+
+static void count_bin(struct histogram *h, int i, uint64_t n)
+{
+        uint64_t **chunk = &h->chunks[i / CHUNK_BINS];
+
+        if (!*chunk) {
+                *chunk = calloc(CHUNK_BINS, sizeof(**chunk));
+                if (!*chunk)
+                        PLOG_FATAL(h->cb, "calloc histogram chunk");
+                if (i / CHUNK_BINS < h->lo)
+                        h->lo = i / CHUNK_BINS;
+                if (i / CHUNK_BINS >= h->hi)
+                        h->hi = i / CHUNK_BINS + 1;
+        }
+        (*chunk)[i % CHUNK_BINS] += n;
+}
+
+static uint64_t to_ns(double val)
+{
+        if (!(val > 0))
+                return 0;
+        if (val * 1e9 >= 1ULL << MAX_MAGNITUDE)
+                return (1ULL << MAX_MAGNITUDE) - 1;
+        return val * 1e9 + 0.5;
+}
+
+void histogram_add(struct histogram *h, double val)
+{
+        double delta;
+
+        count_bin(h, bin_of(h, to_ns(val)), 1);
+        if (val < h->min)
+                h->min = val;
+        if (val > h->max)
+                h->max = val;
+        /* Welford's running mean and variance */
+        h->count++;
+        delta = val - h->mean;
+        h->mean += delta / h->count;
+        h->m2 += delta * (val - h->mean);
+        if (h->raw)
+                numlist_add(h->raw, val);
+}
+
+void histogram_merge(struct histogram *h, const struct histogram *src)
+{
+        size_t count = h->count + src->count;
+        double delta = src->mean - h->mean;
+        int i, j;
+
+        if (src->n_bins != h->n_bins)
+                LOG_FATAL(h->cb, "merging histograms of different precision");
+        if (!src->count)
+                return;
+        for (i = src->lo; i < src->hi; i++) {
+                if (!src->chunks[i])
+                        continue;
+                for (j = 0; j < CHUNK_BINS; j++) {
+                        if (src->chunks[i][j])
+                                count_bin(h, i * CHUNK_BINS + j,
+                                          src->chunks[i][j]);
+                }
+        }
+        if (src->min < h->min)
+                h->min = src->min;
+        if (src->max > h->max)
+                h->max = src->max;
+        h->m2 += src->m2 + delta * delta * h->count * src->count / count;
+        h->mean += delta * src->count / count;
+        h->count = count;
+        if (h->raw && src->raw)
+                numlist_append(h->raw, src->raw);
+}
+
+void histogram_reset(struct histogram *h)
+{
+        int i;
+
+        if (!h->count)
+                return;
+        for (i = h->lo; i < h->hi; i++) {
+                if (h->chunks[i])
+                        memset(h->chunks[i], 0, CHUNK_BINS * sizeof(**h->chunks));
+        }
+        h->count = 0;
+        h->min = INFINITY;
+        h->max = -INFINITY;
+        h->mean = 0;
+        h->m2 = 0;
+        if (h->raw) {
+                numlist_destroy(h->raw);
+                h->raw = numlist_create(h->cb);
+        }
+}
+
+size_t histogram_count(const struct histogram *h)
+{
+        return h->count;
+}
+
+double histogram_min(const struct histogram *h)
+{
+        return h->min;
+}
+
+double histogram_max(const struct histogram *h)
+{
+        return h->max;
+}
+
+double histogram_mean(const struct histogram *h)
+{
+        return h->count ? h->mean : NAN;
+}
+
+double histogram_stddev(const struct histogram *h)
+{
+        return h->count ? sqrt(h->m2 / h->count) : NAN;
+}
+
+double histogram_percentile(const struct histogram *h, double percentile)
+{
+        uint64_t rank, seen = 0;
+        double val;
+        int i, j;
+
+        if (!h->count)
+                return NAN;
+        if (h->raw)
+                return numlist_percentile(h->raw, percentile);
+        /* The same value a sorted list of all values has at this index */
+        rank = (uint64_t) ((h->count - 1) * percentile / 100) + 1;
+        for (i = h->lo; i < h->hi; i++) {
+                if (!h->chunks[i])
+                        continue;
+                for (j = 0; j < CHUNK_BINS; j++) {
+                        seen += h->chunks[i][j];
+                        if (seen >= rank)
+                                goto found;
+                }
+        }
+        return h->max;
+found:
+        val = bin_top(h, i * CHUNK_BINS + j) / 1e9;
+        if (val > h->max)
+                return h->max;
+        if (val < h->min)
+                return h->min;
+        return val;
+}
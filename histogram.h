@@ -0,0 +1,54 @@
+/*
+ * Copyright 2018 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NEPER_HISTOGRAM_H
+#define NEPER_HISTOGRAM_H
+
+/*
+ * Latency histogram in the style of HdrHistogram. Values, in seconds, are
+ * recorded to the nanosecond in log-linear buckets: every power of two is
+ * split into enough linear bins to keep the configured number of
+ * significant decimal digits. Recording is O(1) and memory doesn't grow
+ * with the number of values, only with the range they cover. Min, max,
+ * mean and stddev are exact, percentiles exact to the precision.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct callbacks;
+struct histogram;
+
+/* Significant digits, 1 to 4, of the histograms created from now on, and
+ * whether they also keep every value to compute exact percentiles from. */
+void histogram_configure(int digits, bool keep_raw);
+
+struct histogram *histogram_create(struct callbacks *cb);
+void histogram_destroy(struct histogram *h);
+void histogram_add(struct histogram *h, double val);
+/* Add the values of @src to @h. */
+void histogram_merge(struct histogram *h, const struct histogram *src);
+/* Forget all values, keeping the bins allocated so far for reuse. */
+void histogram_reset(struct histogram *h);
+size_t histogram_count(const struct histogram *h);
+double histogram_min(const struct histogram *h);
+double histogram_max(const struct histogram *h);
+double histogram_mean(const struct histogram *h);
+double histogram_stddev(const struct histogram *h);
+/* The value below which @percentile percent of the values fall, e.g. 99.9 */
+double histogram_percentile(const struct histogram *h, double percentile);
+
+#endif
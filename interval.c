@@ -15,12 +15,18 @@
  */
 
 #include "interval.h"
+#include <errno.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 #include "common.h"
 #include "flow.h"
+#include "lib.h"
+#include "live.h"
 #include "sample.h"
 #include "thread.h"
 
@@ -30,6 +36,9 @@ struct interval {
         pthread_mutex_t *time_start_mutex;
         struct rusage *rusage_start;
         struct timespec last_time;
+        int timer_fd;                   /* of a thread's own interval */
+        ssize_t bytes_read;             /* of the flow, added to the thread */
+        unsigned long transactions;     /* so far */
 };
 
 static inline void set_uninitialized(struct timespec *ts)
@@ -67,6 +76,9 @@ struct interval *interval_create(double interval_in_seconds, struct thread *t)
         itv->time_start_mutex = t->time_start_mutex;
         itv->rusage_start = t->rusage_start;
         set_uninitialized(&itv->last_time);
+        itv->timer_fd = -1;
+        itv->bytes_read = 0;
+        itv->transactions = 0;
         return itv;
 }
 
@@ -86,23 +98,102 @@ static void get_next_time(struct interval *itv, double duration)
         itv->last_time.tv_nsec = frac_part * 1e9;
 }
 
+/*
+ * Adds what @flow did since it was last seen to the thread's running
+ * totals: the live ones, and with thread_samples those sampled by the
+ * thread's timer, in which case the flow also records its latencies
+ * straight into the thread's histograms.
+ */
+static void account(struct flow *flow, struct thread *t)
+{
+        struct interval *itv = flow->itv;
+        struct sample_store *st = t->samples;
+        ssize_t bytes_read = flow->bytes_read - itv->bytes_read;
+        unsigned long transactions = flow->transactions - itv->transactions;
+
+        itv->bytes_read = flow->bytes_read;
+        itv->transactions = flow->transactions;
+        if (t->live)
+                live_add(t->live, bytes_read, transactions);
+        if (!t->opts->thread_samples)
+                return;
+        if (!flow->thread_latency)
+                sample_store_adopt(st, flow);
+        st->bytes_read += bytes_read;
+        st->transactions += transactions;
+}
+
 void interval_collect(struct flow *flow, struct thread *t)
 {
         struct interval *itv = flow->itv;
         struct timespec now;
         double duration;
 
+        account(flow, t);
+        if (t->opts->thread_samples)
+                return;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        ensure_initialized(itv, now);
+        duration = seconds_between(&itv->last_time, &now);
+        if (duration < itv->seconds)
+                return;
+        get_next_time(itv, duration);
+        add_sample(t->samples, t->index, flow, &now, &itv->last_time);
+}
+
+struct interval *interval_thread_start(struct thread *t)
+{
+        struct itimerspec its = {0};
+        struct interval *itv;
+        struct timespec now;
+        double first;
+
+        itv = interval_create(t->opts->interval, t);
+        itv->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (itv->timer_fd == -1)
+                PLOG_FATAL(t->cb, "timerfd_create");
         clock_gettime(CLOCK_MONOTONIC, &now);
         ensure_initialized(itv, now);
+        /* Tick on the same grid as the other threads' intervals */
+        its.it_interval.tv_sec = itv->seconds;
+        its.it_interval.tv_nsec = (itv->seconds - (long) itv->seconds) * 1e9;
+        first = to_seconds(itv->last_time) + itv->seconds;
+        while (first <= to_seconds(now))
+                first += itv->seconds;
+        its.it_value.tv_sec = first;
+        its.it_value.tv_nsec = (first - (long) first) * 1e9;
+        if (timerfd_settime(itv->timer_fd, TFD_TIMER_ABSTIME, &its, NULL))
+                PLOG_FATAL(t->cb, "timerfd_settime");
+        return itv;
+}
+
+int interval_timer_fd(const struct interval *itv)
+{
+        return itv->timer_fd;
+}
+
+void interval_tick(struct interval *itv, struct thread *t)
+{
+        struct timespec now;
+        uint64_t ticks;
+        double duration;
+
+        if (read(itv->timer_fd, &ticks, sizeof(ticks)) == -1 &&
+            errno != EAGAIN)
+                PLOG_ERROR(t->cb, "read timerfd");
+        clock_gettime(CLOCK_MONOTONIC, &now);
         duration = seconds_between(&itv->last_time, &now);
         if (duration < itv->seconds)
                 return;
-        add_sample(t->index, flow, &now, &t->samples, t->cb);
         get_next_time(itv, duration);
+        add_thread_sample(t->samples, t->index, &now, &itv->last_time);
 }
 
 void interval_destroy(struct interval *itv)
 {
-        if (itv)
-                free(itv);
+        if (!itv)
+                return;
+        if (itv->timer_fd != -1)
+                do_close(itv->timer_fd);
+        free(itv);
 }
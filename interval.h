@@ -23,6 +23,12 @@ struct interval;
 
 struct interval *interval_create(double interval_in_seconds, struct thread *t);
 void interval_collect(struct flow *flow, struct thread *t);
+
+/* With thread_samples: the thread's own interval, whose timer fd turns
+ * readable at the end of each interval, when interval_tick() is due. */
+struct interval *interval_thread_start(struct thread *t);
+int interval_timer_fd(const struct interval *itv);
+void interval_tick(struct interval *itv, struct thread *t);
 void interval_destroy(struct interval *itv);
 
 #endif
@@ -20,6 +20,8 @@
 #include <stdbool.h>
 #include "percentiles.h"
 
+struct size_dist;
+
 struct callbacks {
         void *logger;
 
@@ -69,10 +71,20 @@ struct options {
         bool debug;
         bool dry_run;
         bool pin_cpu;
+        const char *cpu_list;
+        int main_cpu;
+        int numa_node;
+        const char *numa_netdev;
+        const char *steer_incoming;
         bool reuseaddr;
         bool reuseport;
+        bool reuseport_cpu;
         bool logtostderr;
         bool nonblocking;
+        bool io_uring;
+        bool tcp_info;
+        bool thread_samples;
+        bool verify;
         double interval;
         long long max_pacing_rate;
         const char *local_host;
@@ -80,6 +92,7 @@ struct options {
         const char *control_port;
         const char *port;
         const char *all_samples;
+        const char *live;
         const char *script;
 
         /* tcp_stream, udp_stream */
@@ -88,15 +101,54 @@ struct options {
         bool edge_trigger;
         unsigned long delay;
 
-        /* tcp_rr */
+        /* tcp_stream */
+        bool zerocopy;
+        int zerocopy_bufs;
+        bool zerocopy_receive;
+        bool sendfile;
+        const char *sendfile_path;
+        bool splice;
+        bool splice_receive;
+        long long flow_rate;
+        int flow_burst;
+
+        /* udp_stream */
+        int batch_size;
+        int gso_size;
+        bool gro;
+        double pps;
+        long long send_rate;
+        bool txtime;
+
+        /* tcp_rr, tcp_crr, udp_rr */
         int request_size;
         int response_size;
         struct percentiles percentiles;
+        int latency_digits;
+        bool latency_raw;
+
+        /* tcp_rr */
+        double request_rate;
+        bool poisson;
+        int pipeline;
+        struct size_dist *request_dist;
+        struct size_dist *response_dist;
+        bool timestamping;
+
+        /* tcp_crr */
+        bool fastopen;
+        bool linger_rst;
+        bool bind_no_port;
+
+        /* udp_rr */
+        int retransmit_timeout;
 };
 
 int tcp_stream(struct options *opts, struct callbacks *cb);
 int tcp_rr(struct options *opts, struct callbacks *cb);
+int tcp_crr(struct options *opts, struct callbacks *cb);
 
 int udp_stream(struct options *opts, struct callbacks *cb);
+int udp_rr(struct options *opts, struct callbacks *cb);
 
 #endif
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2018 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "live.h"
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include "histogram.h"
+#include "lib.h"
+#include "logging.h"
+#include "percentiles.h"
+#include "sample.h"
+#include "thread.h"
+
+struct live {
+        struct options *opts;
+        struct callbacks *cb;
+        struct live_thread *threads;
+        int n;
+        FILE *out;
+        int stop_efd;
+        pthread_t id;
+        struct histogram *latency;      /* of the line being printed */
+        struct timespec start;
+        struct timespec last_time;
+        unsigned long long last_bytes;
+        unsigned long last_transactions;
+};
+
+struct live *live_create(struct thread *workers, int n, struct options *opts,
+                         struct callbacks *cb)
+{
+        struct live *lv;
+        int i, r;
+
+        if (!opts->live)
+                return NULL;
+        lv = calloc(1, sizeof(*lv));
+        if (!lv)
+                PLOG_FATAL(cb, "calloc live");
+        lv->opts = opts;
+        lv->cb = cb;
+        lv->n = n;
+        /* Each block starts a cache line, the array needs no padding */
+        r = posix_memalign((void **) &lv->threads, CACHELINE_SIZE,
+                           n * sizeof(lv->threads[0]));
+        if (r)
+                LOG_FATAL(cb, "posix_memalign: %s", strerror(r));
+        memset(lv->threads, 0, n * sizeof(lv->threads[0]));
+        for (i = 0; i < n; i++) {
+                pthread_mutex_init(&lv->threads[i].lock, NULL);
+                lv->threads[i].latency = histogram_create(cb);
+                workers[i].live = &lv->threads[i];
+                workers[i].samples->live = &lv->threads[i];
+        }
+        lv->latency = histogram_create(cb);
+        if (!strcmp(opts->live, LIVE_STDERR)) {
+                lv->out = stderr;
+        } else {
+                lv->out = fopen(opts->live, "a");
+                if (!lv->out)
+                        PLOG_FATAL(cb, "fopen(%s)", opts->live);
+        }
+        lv->stop_efd = eventfd(0, 0);
+        if (lv->stop_efd == -1)
+                PLOG_FATAL(cb, "eventfd");
+        return lv;
+}
+
+void live_add_latency(struct live_thread *lt, const struct histogram *h)
+{
+        if (!histogram_count(h))
+                return;
+        pthread_mutex_lock(&lt->lock);
+        histogram_merge(lt->latency, h);
+        pthread_mutex_unlock(&lt->lock);
+}
+
+static void print_header(struct live *lv)
+{
+        struct percentiles *pct = &lv->opts->percentiles;
+        char key[32];
+        int i;
+
+        fprintf(lv->out, "time,transactions,tps,bytes_read,throughput_Mbps");
+        fprintf(lv->out, ",latency_samples,latency_mean,latency_max");
+        for (i = 0; i < pct->num; i++) {
+                percentile_key(key, sizeof(key), "latency", pct->values[i]);
+                fprintf(lv->out, ",%s", key);
+        }
+        fprintf(lv->out, "\n");
+        fflush(lv->out);
+}
+
+/* One line covering what happened since the previous one. */
+static void print_line(struct live *lv)
+{
+        struct percentiles *pct = &lv->opts->percentiles;
+        unsigned long long bytes = 0;
+        unsigned long transactions = 0;
+        struct live_thread *lt;
+        struct timespec now;
+        double duration;
+        int i;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (i = 0; i < lv->n; i++) {
+                lt = &lv->threads[i];
+                bytes += __atomic_load_n(&lt->bytes_read, __ATOMIC_RELAXED);
+                transactions += __atomic_load_n(&lt->transactions,
+                                                __ATOMIC_RELAXED);
+                pthread_mutex_lock(&lt->lock);
+                histogram_merge(lv->latency, lt->latency);
+                histogram_reset(lt->latency);
+                pthread_mutex_unlock(&lt->lock);
+        }
+        duration = seconds_between(&lv->last_time, &now);
+        fprintf(lv->out, "%.3f,%lu,%.2f,%llu,%.2f",
+                seconds_between(&lv->start, &now),
+                transactions - lv->last_transactions,
+                (transactions - lv->last_transactions) / duration,
+                bytes - lv->last_bytes,
+                (bytes - lv->last_bytes) * 8 / duration / 1e6);
+        fprintf(lv->out, ",%zu,%f,%f", histogram_count(lv->latency),
+                histogram_mean(lv->latency),
+                histogram_count(lv->latency) ? histogram_max(lv->latency) :
+                                               NAN);
+        for (i = 0; i < pct->num; i++)
+                fprintf(lv->out, ",%f",
+                        histogram_percentile(lv->latency, pct->values[i]));
+        fprintf(lv->out, "\n");
+        fflush(lv->out);
+        histogram_reset(lv->latency);
+        lv->last_time = now;
+        lv->last_bytes = bytes;
+        lv->last_transactions = transactions;
+}
+
+static void *live_run(void *arg)
+{
+        struct live *lv = arg;
+        struct pollfd pfd = { .fd = lv->stop_efd, .events = POLLIN };
+        struct timespec next, now;
+        int ms;
+
+        print_header(lv);
+        clock_gettime(CLOCK_MONOTONIC, &lv->start);
+        lv->last_time = next = lv->start;
+        /* Latencies come in with the samples, at the end of each interval:
+         * stay half an interval away from that so every line gets one
+         * round of them */
+        timespec_add(&next, lv->opts->interval / 2);
+        for (;;) {
+                timespec_add(&next, lv->opts->interval);
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                ms = seconds_between(&now, &next) * 1000;
+                if (ms < 0)
+                        ms = 0;
+                if (poll(&pfd, 1, ms) == -1 && errno != EINTR)
+                        PLOG_FATAL(lv->cb, "poll");
+                if (pfd.revents & POLLIN)
+                        break;
+                print_line(lv);
+        }
+        return NULL;
+}
+
+void live_start(struct live *lv)
+{
+        int r;
+
+        if (!lv)
+                return;
+        r = pthread_create(&lv->id, NULL, live_run, lv);
+        if (r)
+                LOG_FATAL(lv->cb, "pthread_create: %s", strerror(r));
+}
+
+void live_stop(struct live *lv)
+{
+        int r;
+
+        if (!lv)
+                return;
+        if (eventfd_write(lv->stop_efd, 1))
+                PLOG_FATAL(lv->cb, "eventfd_write");
+        r = pthread_join(lv->id, NULL);
+        if (r)
+                LOG_FATAL(lv->cb, "pthread_join: %s", strerror(r));
+}
+
+void live_destroy(struct live *lv)
+{
+        int i;
+
+        if (!lv)
+                return;
+        for (i = 0; i < lv->n; i++) {
+                pthread_mutex_destroy(&lv->threads[i].lock);
+                histogram_destroy(lv->threads[i].latency);
+        }
+        free(lv->threads);
+        histogram_destroy(lv->latency);
+        if (lv->out != stderr && fclose(lv->out))
+                PLOG_ERROR(lv->cb, "fclose");
+        do_close(lv->stop_efd);
+        free(lv);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2018 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NEPER_LIVE_H
+#define NEPER_LIVE_H
+
+/*
+ * Live reporting. While the test runs, a reporter thread prints a line per
+ * interval with what all workers did in it: transactions, bytes read and
+ * the latencies of the samples taken since the previous line. Workers
+ * publish their running totals in a block of their own that nothing else
+ * writes to, read without locks; latencies are handed over under a
+ * per-thread lock, but only as samples are taken, never per transaction.
+ */
+
+#include <pthread.h>
+#include <sys/types.h>
+#include "common.h"
+
+struct callbacks;
+struct histogram;
+struct options;
+struct thread;
+
+struct live_thread {
+        /* Only written by the worker, on every interval_collect() */
+        unsigned long long bytes_read;
+        unsigned long transactions;
+        /* Taken by the worker once per sample */
+        pthread_mutex_t lock __attribute__((aligned(CACHELINE_SIZE)));
+        struct histogram *latency;
+} __attribute__((aligned(CACHELINE_SIZE)));
+
+struct live;
+
+/* Give the workers their live blocks, t->live, if the live option is set. */
+struct live *live_create(struct thread *workers, int n, struct options *opts,
+                         struct callbacks *cb);
+void live_start(struct live *lv);
+void live_stop(struct live *lv);
+void live_destroy(struct live *lv);
+
+/* Called by the worker owning @lt. */
+static inline void live_add(struct live_thread *lt, ssize_t bytes_read,
+                            unsigned long transactions)
+{
+        __atomic_store_n(&lt->bytes_read, lt->bytes_read + bytes_read,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&lt->transactions, lt->transactions + transactions,
+                         __ATOMIC_RELAXED);
+}
+
+void live_add_latency(struct live_thread *lt, const struct histogram *h);
+
+#endif
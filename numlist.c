@@ -99,6 +99,15 @@ void numlist_concat(struct numlist *lst, struct numlist *tail)
 #define for_each(n, blk, lst) \
         for_each_memblock(blk, lst) for_each_number(n, blk)
 
+void numlist_append(struct numlist *lst, const struct numlist *src)
+{
+        const struct memblock *blk;
+        const double *n;
+
+        for_each(n, blk, src)
+                numlist_add(lst, *n);
+}
+
 size_t numlist_size(struct numlist *lst)
 {
         struct memblock *blk;
@@ -170,7 +179,7 @@ static int compare_doubles(const void *a, const void *b)
         return 0;
 }
 
-double numlist_percentile(struct numlist *lst, int percentile)
+double numlist_percentile(struct numlist *lst, double percentile)
 {
         double *values, *n, result;
         struct memblock *blk;
@@ -183,7 +192,7 @@ double numlist_percentile(struct numlist *lst, int percentile)
         for_each(n, blk, lst)
                 values[i++] = *n;
         qsort(values, size, sizeof(double), compare_doubles);
-        result = values[(size - 1) * percentile / 100];
+        result = values[(size_t) ((size - 1) * percentile / 100)];
         free(values);
         return result;
 }
@@ -30,11 +30,13 @@ void numlist_add(struct numlist *lst, double val);
  * @tail will become empty after this operation.
  */
 void numlist_concat(struct numlist *lst, struct numlist *tail);
+/* The numbers in @src are copied to @lst. */
+void numlist_append(struct numlist *lst, const struct numlist *src);
 size_t numlist_size(struct numlist *lst);
 double numlist_min(struct numlist *lst);
 double numlist_max(struct numlist *lst);
 double numlist_mean(struct numlist *lst);
 double numlist_stddev(struct numlist *lst);
-double numlist_percentile(struct numlist *lst, int percentile);
+double numlist_percentile(struct numlist *lst, double percentile);
 
 #endif
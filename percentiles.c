@@ -16,7 +16,6 @@
 
 #include "percentiles.h"
 #include <errno.h>
-#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,20 +26,31 @@ void parse_percentiles(char *arg, void *out, struct callbacks *cb)
 {
         struct percentiles *p = out;
         char *endptr;
-        long val;
+        double val;
+        int i;
 
         while (true) {
                 errno = 0;
-                val = strtol(arg, &endptr, 10);
-                if ((errno == ERANGE && (val == LONG_MAX || val == LONG_MIN)) ||
-                    (errno != 0 && val == 0))
-                        PLOG_FATAL(cb, "strtol");
+                val = strtod(arg, &endptr);
+                if (errno == ERANGE)
+                        PLOG_FATAL(cb, "strtod");
                 if (endptr == arg)
                         break;
-                if (val < 0 || val > 100)
-                        LOG_FATAL(cb, "%ld percentile doesn't exist", val);
-                p->chosen[val] = true;
-                LOG_INFO(cb, "%ld percentile is chosen", val);
+                if (!(val >= 0 && val <= 100))
+                        LOG_FATAL(cb, "%g percentile doesn't exist", val);
+                /* keep them sorted, and each once */
+                for (i = 0; i < p->num && p->values[i] < val; i++)
+                        ;
+                if (i == p->num || p->values[i] != val) {
+                        if (p->num == MAX_PERCENTILES)
+                                LOG_FATAL(cb, "more than %d percentiles",
+                                          MAX_PERCENTILES);
+                        memmove(&p->values[i + 1], &p->values[i],
+                                (p->num - i) * sizeof(p->values[0]));
+                        p->values[i] = val;
+                        p->num++;
+                }
+                LOG_INFO(cb, "%g percentile is chosen", val);
                 if (*endptr == '\0')
                         break;
                 arg = endptr + 1;
@@ -50,16 +60,16 @@ void parse_percentiles(char *arg, void *out, struct callbacks *cb)
 void print_percentiles(const char *name, const void *var, struct callbacks *cb)
 {
         const struct percentiles *p = var;
-        char buf[10], s[400] = "";
-        int i;
+        char s[MAX_PERCENTILES * 16] = "";
+        int i, len = 0;
 
-        for (i = 0; i <= 100; i++) {
-                if (p->chosen[i]) {
-                        sprintf(buf, "%d,", i);
-                        strcat(s, buf);
-                }
-        }
-        if (strlen(s) > 0)
-                s[strlen(s) - 1] = '\0'; /* remove trailing comma */
+        for (i = 0; i < p->num; i++)
+                len += snprintf(s + len, sizeof(s) - len, "%s%g",
+                                i ? "," : "", p->values[i]);
         PRINT(cb, name, "%s", s);
 }
+
+void percentile_key(char *key, size_t len, const char *name, double p)
+{
+        snprintf(key, len, "%s_p%g", name, p);
+}
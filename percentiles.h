@@ -17,15 +17,21 @@
 #ifndef NEPER_PERCENTILES_H
 #define NEPER_PERCENTILES_H
 
-#include <stdbool.h>
+#include <stddef.h>
 
 struct callbacks;
 
+#define MAX_PERCENTILES 32
+
+/* Chosen percentiles in ascending order, fractional ones like 99.99 too */
 struct percentiles {
-        bool chosen[101];
+        int num;
+        double values[MAX_PERCENTILES];
 };
 
 void parse_percentiles(char *arg, void *out, struct callbacks *cb);
 void print_percentiles(const char *name, const void *var, struct callbacks *cb);
+/* The output key of percentile @p of @name, e.g. latency_p99.9 */
+void percentile_key(char *key, size_t len, const char *name, double p);
 
 #endif
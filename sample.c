@@ -16,46 +16,259 @@
 
 #include "sample.h"
 #include <errno.h>
+#include <linux/tcp.h>
+#include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "common.h"
 #include "flow.h"
+#include "histogram.h"
 #include "lib.h"
+#include "live.h"
 #include "logging.h"
-#include "numlist.h"
 #include "percentiles.h"
 
-void add_sample(int tid, struct flow *flow, struct timespec *ts,
-                struct sample **samples, struct callbacks *cb)
+/* tcpi_state of a listening socket, TCP_LISTEN in <netinet/tcp.h>, which
+ * doesn't mix with the <linux/tcp.h> needed for a recent struct tcp_info */
+#define TCPI_STATE_LISTEN 10
+
+/* One getsockopt() per flow and interval, cheap enough to leave on. */
+static void sample_tcp_info(int fd, struct sample_tcp_info *sti)
+{
+        struct tcp_info ti;
+        socklen_t len = sizeof(ti);
+
+        memset(&ti, 0, sizeof(ti));
+        if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &ti, &len))
+                return;
+        /* listening sockets have nothing to tell */
+        if (ti.tcpi_state == TCPI_STATE_LISTEN)
+                return;
+        sti->valid = true;
+        sti->srtt = ti.tcpi_rtt;
+        sti->rttvar = ti.tcpi_rttvar;
+        sti->snd_cwnd = ti.tcpi_snd_cwnd;
+        sti->total_retrans = ti.tcpi_total_retrans;
+        /* zero on kernels that return a shorter struct */
+        sti->delivery_rate = ti.tcpi_delivery_rate;
+        sti->busy_time = ti.tcpi_busy_time;
+        sti->rwnd_limited = ti.tcpi_rwnd_limited;
+        sti->sndbuf_limited = ti.tcpi_sndbuf_limited;
+}
+
+struct sample_store *sample_store_create(bool tcp_info, bool keep_latency,
+                                         struct callbacks *cb)
+{
+        struct sample_store *st;
+        int r;
+
+        /* The totals of thread_samples change on every read */
+        r = posix_memalign((void **) &st, CACHELINE_SIZE, sizeof(*st));
+        if (r)
+                LOG_FATAL(cb, "posix_memalign: %s", strerror(r));
+        memset(st, 0, sizeof(*st));
+        st->cb = cb;
+        st->tcp_info = tcp_info;
+        st->keep_latency = keep_latency;
+        return st;
+}
+
+void sample_store_destroy(struct sample_store *st)
+{
+        struct sample_chunk *chunk, *next;
+        struct rusage_chunk *rc, *rc_next;
+        int i;
+
+        if (!st)
+                return;
+        for (chunk = st->head; chunk; chunk = next) {
+                next = chunk->next;
+                for (i = 0; i < chunk->len; i++) {
+                        if (chunk->samples[i].latency)
+                                histogram_destroy(chunk->samples[i].latency);
+                }
+                free(chunk);
+        }
+        for (rc = st->rusage; rc; rc = rc_next) {
+                rc_next = rc->next;
+                free(rc);
+        }
+        if (st->latency)
+                histogram_destroy(st->latency);
+        if (st->connect_latency)
+                histogram_destroy(st->connect_latency);
+        if (st->first_byte_latency)
+                histogram_destroy(st->first_byte_latency);
+        if (st->cur_latency)
+                histogram_destroy(st->cur_latency);
+        if (st->cur_connect_latency)
+                histogram_destroy(st->cur_connect_latency);
+        if (st->cur_first_byte_latency)
+                histogram_destroy(st->cur_first_byte_latency);
+        free(st);
+}
+
+static struct sample *next_sample(struct sample_store *st)
 {
-        struct sample *sample = calloc(1, sizeof(struct sample));
+        struct sample_chunk *chunk = st->tail;
+
+        if (!chunk || chunk->len == SAMPLES_PER_CHUNK) {
+                /* not calloc(), pages are only touched as samples come */
+                chunk = malloc(sizeof(*chunk));
+                if (!chunk)
+                        PLOG_FATAL(st->cb, "malloc sample_chunk");
+                chunk->next = NULL;
+                chunk->len = 0;
+                if (st->tail)
+                        st->tail->next = chunk;
+                else
+                        st->head = chunk;
+                st->tail = chunk;
+        }
+        st->count++;
+        return &chunk->samples[chunk->len++];
+}
+
+/* The thread's resource usage, read anew once per interval. */
+static const struct rusage *interval_rusage(struct sample_store *st,
+                                            const struct timespec *ts,
+                                            const struct timespec *start)
+{
+        struct rusage_chunk *rc = st->rusage;
+
+        if (rc && timespec_cmp(&st->rusage_time, start) >= 0)
+                return &rc->rusages[rc->len - 1];
+        if (!rc || rc->len == RUSAGES_PER_CHUNK) {
+                rc = malloc(sizeof(*rc));
+                if (!rc)
+                        PLOG_FATAL(st->cb, "malloc rusage_chunk");
+                rc->next = st->rusage;
+                rc->len = 0;
+                st->rusage = rc;
+        }
+        getrusage(RUSAGE_THREAD, &rc->rusages[rc->len]);
+        st->rusage_time = *ts;
+        return &rc->rusages[rc->len++];
+}
+
+/* Moves the values of @src to *@dst, created on first use. */
+static void drain_latency(struct histogram **dst, struct histogram *src,
+                          struct callbacks *cb)
+{
+        if (!*dst)
+                *dst = histogram_create(cb);
+        histogram_merge(*dst, src);
+        histogram_reset(src);
+}
+
+/* Hand the latencies of an interval to the thread's histograms. */
+static void take_latencies(struct sample_store *st, struct sample *sample,
+                           struct histogram *latency,
+                           struct histogram *connect_latency,
+                           struct histogram *first_byte_latency)
+{
+        sample->latency = NULL;
+        if (st->live)
+                live_add_latency(st->live, latency);
+        if (st->keep_latency) {
+                sample->latency = histogram_create(st->cb);
+                histogram_merge(sample->latency, latency);
+        }
+        drain_latency(&st->latency, latency, st->cb);
+        if (connect_latency)
+                drain_latency(&st->connect_latency, connect_latency, st->cb);
+        if (first_byte_latency)
+                drain_latency(&st->first_byte_latency, first_byte_latency,
+                              st->cb);
+}
+
+void add_sample(struct sample_store *st, int tid, struct flow *flow,
+                const struct timespec *ts,
+                const struct timespec *interval_start)
+{
+        struct sample *sample = next_sample(st);
+
         sample->tid = tid;
         sample->flow_id = flow->id;
         sample->bytes_read = flow->bytes_read;
         sample->transactions = flow->transactions;
-        sample->latency = flow->latency;
-        flow->latency = numlist_create(cb);
+        take_latencies(st, sample, flow->latency, flow->connect_latency,
+                       flow->first_byte_latency);
         sample->timestamp = *ts;
-        getrusage(RUSAGE_THREAD, &sample->rusage);
-        sample->next = *samples;
-        *samples = sample;
+        sample->rusage = interval_rusage(st, ts, interval_start);
+        memset(&sample->tcp_info, 0, sizeof(sample->tcp_info));
+        if (st->tcp_info)
+                sample_tcp_info(flow->fd, &sample->tcp_info);
 }
 
-void print_sample(FILE *csv, struct percentiles *percentiles,
+static void adopt_latency(struct histogram **cur, struct histogram **own,
+                          struct callbacks *cb)
+{
+        if (!*own)
+                return;
+        if (!*cur)
+                *cur = histogram_create(cb);
+        histogram_merge(*cur, *own);
+        histogram_destroy(*own);
+        *own = *cur;
+}
+
+void sample_store_adopt(struct sample_store *st, struct flow *flow)
+{
+        adopt_latency(&st->cur_latency, &flow->latency, st->cb);
+        adopt_latency(&st->cur_connect_latency, &flow->connect_latency,
+                      st->cb);
+        adopt_latency(&st->cur_first_byte_latency, &flow->first_byte_latency,
+                      st->cb);
+        flow->thread_latency = true;
+}
+
+void add_thread_sample(struct sample_store *st, int tid,
+                       const struct timespec *ts,
+                       const struct timespec *interval_start)
+{
+        struct sample *sample = next_sample(st);
+
+        if (!st->cur_latency)
+                st->cur_latency = histogram_create(st->cb);
+        sample->tid = tid;
+        sample->flow_id = 0;
+        sample->bytes_read = st->bytes_read;
+        sample->transactions = st->transactions;
+        take_latencies(st, sample, st->cur_latency, st->cur_connect_latency,
+                       st->cur_first_byte_latency);
+        sample->timestamp = *ts;
+        sample->rusage = interval_rusage(st, ts, interval_start);
+        memset(&sample->tcp_info, 0, sizeof(sample->tcp_info));
+}
+
+void print_sample(FILE *csv, struct percentiles *percentiles, bool tcp_info,
                   struct sample *sample)
 {
+        const struct sample_tcp_info *sti;
+        const struct rusage *ru;
+
         if (!sample) {
                 fprintf(csv, "time,tid,flow_id,bytes_read,transactions");
                 fprintf(csv, ",latency_min,latency_mean,latency_max");
                 fprintf(csv, ",latency_stddev");
                 if (percentiles) {
+                        char key[32];
                         int i;
-                        for (i = 0; i <= 100; i++) {
-                                if (percentiles->chosen[i])
-                                        fprintf(csv, ",latency_p%d", i);
+
+                        for (i = 0; i < percentiles->num; i++) {
+                                percentile_key(key, sizeof(key), "latency",
+                                               percentiles->values[i]);
+                                fprintf(csv, ",%s", key);
                         }
                 }
                 fprintf(csv, ",utime,stime,maxrss,minflt,majflt,nvcsw,nivcsw");
+                if (tcp_info) {
+                        fprintf(csv, ",srtt,rttvar,snd_cwnd,total_retrans");
+                        fprintf(csv, ",delivery_rate,busy_time,rwnd_limited");
+                        fprintf(csv, ",sndbuf_limited");
+                }
                 fprintf(csv, "\n");
                 return;
         }
@@ -64,36 +277,49 @@ void print_sample(FILE *csv, struct percentiles *percentiles,
                 sample->tid, sample->flow_id, sample->bytes_read,
                 sample->transactions);
         fprintf(csv, ",%f,%f,%f,%f",
-                numlist_min(sample->latency), numlist_mean(sample->latency),
-                numlist_max(sample->latency), numlist_stddev(sample->latency));
+                histogram_min(sample->latency), histogram_mean(sample->latency),
+                histogram_max(sample->latency), histogram_stddev(sample->latency));
         if (percentiles) {
                 int i;
-                for (i = 0; i <= 100; i++) {
-                        if (percentiles->chosen[i]) {
-                                fprintf(csv, ",%f",
-                                        numlist_percentile(sample->latency, i));
-                        }
+                for (i = 0; i < percentiles->num; i++) {
+                        fprintf(csv, ",%f",
+                                histogram_percentile(sample->latency,
+                                                     percentiles->values[i]));
                 }
         }
+        ru = sample->rusage;
         fprintf(csv, ",%ld.%06ld,%ld.%06ld,%ld,%ld,%ld,%ld,%ld",
-                sample->rusage.ru_utime.tv_sec, sample->rusage.ru_utime.tv_usec,
-                sample->rusage.ru_stime.tv_sec, sample->rusage.ru_stime.tv_usec,
-                sample->rusage.ru_maxrss,
-                sample->rusage.ru_minflt, sample->rusage.ru_majflt,
-                sample->rusage.ru_nvcsw, sample->rusage.ru_nivcsw);
+                ru->ru_utime.tv_sec, ru->ru_utime.tv_usec,
+                ru->ru_stime.tv_sec, ru->ru_stime.tv_usec,
+                ru->ru_maxrss, ru->ru_minflt, ru->ru_majflt,
+                ru->ru_nvcsw, ru->ru_nivcsw);
+        sti = &sample->tcp_info;
+        if (tcp_info && sti->valid) {
+                fprintf(csv, ",%u,%u,%u,%u",
+                        sti->srtt, sti->rttvar, sti->snd_cwnd,
+                        sti->total_retrans);
+                fprintf(csv, ",%llu,%llu,%llu,%llu",
+                        (unsigned long long) sti->delivery_rate,
+                        (unsigned long long) sti->busy_time,
+                        (unsigned long long) sti->rwnd_limited,
+                        (unsigned long long) sti->sndbuf_limited);
+        } else if (tcp_info) {
+                fprintf(csv, ",,,,,,,,");
+        }
         fprintf(csv, "\n");
 }
 
-void print_samples(struct percentiles *percentiles, struct sample *samples,
-                   int num, const char *filename, struct callbacks *cb)
+void print_samples(struct percentiles *percentiles, bool tcp_info,
+                   struct sample *samples, int num, const char *filename,
+                   struct callbacks *cb)
 {
         FILE *csv = fopen(filename, "w");
         if (csv) {
                 int i;
                 LOG_INFO(cb, "successfully opened %s", filename);
-                print_sample(csv, percentiles, NULL);
+                print_sample(csv, percentiles, tcp_info, NULL);
                 for (i = 0; i < num; i++)
-                        print_sample(csv, percentiles, &samples[i]);
+                        print_sample(csv, percentiles, tcp_info, &samples[i]);
                 if (fclose(csv))
                         LOG_ERROR(cb, "fclose: %s", strerror(errno));
         } else {
@@ -114,16 +340,3 @@ int compare_samples(const void *a, const void *b)
                 return 1;
         return 0;
 }
-
-void free_samples(struct sample *samples)
-{
-        struct sample *sample, *next;
-
-        sample = samples;
-        while (sample) {
-                numlist_destroy(sample->latency);
-                next = sample->next;
-                free(sample);
-                sample = next;
-        }
-}
@@ -17,34 +17,121 @@
 #ifndef NEPER_SAMPLE_H
 #define NEPER_SAMPLE_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <sys/resource.h>
 #include <sys/time.h>
+#include "common.h"
 
 struct callbacks;
 struct flow;
-struct numlist;
+struct histogram;
+struct live_thread;
 struct percentiles;
 
+/* What TCP_INFO said about a flow when the sample was taken. Times are in
+ * microseconds and, like total_retrans, count from the connection's start. */
+struct sample_tcp_info {
+        bool valid;                     /* false if not a connected TCP flow */
+        uint32_t srtt;
+        uint32_t rttvar;
+        uint32_t snd_cwnd;              /* segments */
+        uint32_t total_retrans;         /* segments */
+        uint64_t delivery_rate;         /* bytes per second */
+        uint64_t busy_time;
+        uint64_t rwnd_limited;
+        uint64_t sndbuf_limited;
+};
+
+/*
+ * The numbers of a flow at the end of an interval. Latencies are merged
+ * into the thread's histograms as they are sampled; a sample only keeps its
+ * own when every sample gets printed.
+ */
 struct sample {
         int tid;
         int flow_id;
         ssize_t bytes_read;
         unsigned long transactions;
-        struct numlist *latency;
+        struct histogram *latency;              /* NULL unless all_samples */
         struct timespec timestamp;
-        struct rusage rusage;
-        struct sample *next;
+        const struct rusage *rusage;            /* of the thread, shared */
+        struct sample_tcp_info tcp_info;        /* with --tcp-info */
+};
+
+/* Samples are stored this many at a time, getrusage() results fewer */
+#define SAMPLES_PER_CHUNK 1024
+#define RUSAGES_PER_CHUNK 64
+
+struct sample_chunk {
+        struct sample_chunk *next;
+        int len;
+        struct sample samples[SAMPLES_PER_CHUNK];
+};
+
+struct rusage_chunk {
+        struct rusage_chunk *next;
+        int len;
+        struct rusage rusages[RUSAGES_PER_CHUNK];
 };
 
-void add_sample(int tid, struct flow *flow, struct timespec *ts,
-                struct sample **samples, struct callbacks *cb);
+/*
+ * The samples of a thread, oldest first. Chunks are allocated by the
+ * thread itself when it takes its first sample, so that they live on its
+ * NUMA node, and never move. The thread's resource usage is read once per
+ * interval, all flows sampled in that interval point to the same snapshot.
+ */
+struct sample_store {
+        struct callbacks *cb;
+        bool tcp_info;                  /* snapshot TCP_INFO too */
+        bool keep_latency;              /* give each sample its latencies */
+        struct sample_chunk *head;
+        struct sample_chunk *tail;
+        unsigned long count;
+        struct rusage_chunk *rusage;    /* newest first */
+        struct timespec rusage_time;    /* of the newest snapshot */
+        struct histogram *latency;      /* of all samples */
+        struct histogram *connect_latency;      /* NULL unless tcp_crr */
+        struct histogram *first_byte_latency;   /* NULL unless tcp_crr */
+        /* thread_samples: totals of the thread's flows so far, and their
+         * latencies in the current interval */
+        ssize_t bytes_read;
+        unsigned long transactions;
+        struct histogram *cur_latency;
+        struct histogram *cur_connect_latency;
+        struct histogram *cur_first_byte_latency;
+        struct live_thread *live;       /* also gets the latencies, if set */
+} __attribute__((aligned(CACHELINE_SIZE)));
+
+#define for_each_sample(s, chunk, store)                                \
+        for ((chunk) = (store)->head; (chunk); (chunk) = (chunk)->next) \
+                for ((s) = (chunk)->samples;                            \
+                     (s) < (chunk)->samples + (chunk)->len; (s)++)
+
+struct sample_store *sample_store_create(bool tcp_info, bool keep_latency,
+                                         struct callbacks *cb);
+void sample_store_destroy(struct sample_store *st);
+
+/* Sample @flow at @ts, which falls into the interval that started at
+ * @interval_start. */
+void add_sample(struct sample_store *st, int tid, struct flow *flow,
+                const struct timespec *ts,
+                const struct timespec *interval_start);
+
+/* Make @flow record its latencies into the thread's histograms, which then
+ * take over the values recorded so far. */
+void sample_store_adopt(struct sample_store *st, struct flow *flow);
+/* Sample the totals of the thread's flows; flow_id is 0. */
+void add_thread_sample(struct sample_store *st, int tid,
+                       const struct timespec *ts,
+                       const struct timespec *interval_start);
 
-void print_sample(FILE *csv, struct percentiles *percentiles,
+void print_sample(FILE *csv, struct percentiles *percentiles, bool tcp_info,
                   struct sample *sample);
-void print_samples(struct percentiles *percentiles, struct sample *samples,
-                   int num, const char *filename, struct callbacks *cb);
+void print_samples(struct percentiles *percentiles, bool tcp_info,
+                   struct sample *samples, int num, const char *filename,
+                   struct callbacks *cb);
 int compare_samples(const void *a, const void *b);
-void free_samples(struct sample *samples);
 
 #endif
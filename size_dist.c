@@ -0,0 +1,219 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "size_dist.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+
+enum size_dist_type {
+        SIZE_DIST_FIXED,
+        SIZE_DIST_UNIFORM,
+        SIZE_DIST_EXPONENTIAL,
+        SIZE_DIST_LOGNORMAL,
+        SIZE_DIST_EMPIRICAL,
+};
+
+struct size_dist {
+        enum size_dist_type type;
+        char *spec;             /* as given on the command line */
+        double a, b;            /* parameters, meaning depends on type */
+        int max;
+        /* empirical CDF, sizes ascending */
+        int *sizes;
+        double *cdf;
+        int len;
+};
+
+/* Parse up to @n comma separated numbers from @arg. Returns how many. */
+static int parse_params(const char *arg, double *params, int n,
+                        struct callbacks *cb)
+{
+        char *endptr;
+        int i;
+
+        for (i = 0; i < n && *arg; i++) {
+                params[i] = strtod(arg, &endptr);
+                if (endptr == arg || (*endptr && *endptr != ','))
+                        LOG_FATAL(cb, "invalid size distribution parameter "
+                                  "`%s'", arg);
+                arg = *endptr ? endptr + 1 : endptr;
+        }
+        if (*arg)
+                LOG_FATAL(cb, "too many size distribution parameters");
+        return i;
+}
+
+static void load_empirical(struct size_dist *d, const char *path,
+                           struct callbacks *cb)
+{
+        char line[256];
+        double p, last_p = 0;
+        int size, cap = 0;
+        FILE *f;
+
+        f = fopen(path, "r");
+        if (!f)
+                PLOG_FATAL(cb, "fopen(%s)", path);
+        while (fgets(line, sizeof(line), f)) {
+                if (line[0] == '#' || line[0] == '\n')
+                        continue;
+                if (sscanf(line, "%d %lf", &size, &p) != 2)
+                        LOG_FATAL(cb, "%s: malformed line `%s'", path, line);
+                if (size < 1 || (d->len && size <= d->sizes[d->len - 1]))
+                        LOG_FATAL(cb, "%s: sizes must be positive and "
+                                  "ascending", path);
+                if (p < last_p || p > 1)
+                        LOG_FATAL(cb, "%s: probabilities must be ascending "
+                                  "and at most 1", path);
+                if (d->len == cap) {
+                        cap = cap ? 2 * cap : 16;
+                        d->sizes = realloc(d->sizes, cap * sizeof(int));
+                        d->cdf = realloc(d->cdf, cap * sizeof(double));
+                        if (!d->sizes || !d->cdf)
+                                PLOG_FATAL(cb, "realloc");
+                }
+                d->sizes[d->len] = size;
+                d->cdf[d->len] = p;
+                d->len++;
+                last_p = p;
+        }
+        fclose(f);
+        if (!d->len || last_p != 1)
+                LOG_FATAL(cb, "%s: the CDF must end at probability 1", path);
+        d->max = d->sizes[d->len - 1];
+}
+
+void parse_size_dist(char *arg, void *out, struct callbacks *cb)
+{
+        struct size_dist *d;
+        double params[3] = {0};
+        char *colon;
+        int n;
+
+        d = calloc(1, sizeof(*d));
+        if (!d)
+                PLOG_FATAL(cb, "calloc size_dist");
+        d->spec = strdup(arg);
+        colon = strchr(arg, ':');
+        if (!colon)
+                LOG_FATAL(cb, "size distribution `%s' lacks parameters", arg);
+        *colon = '\0';
+        d->max = SIZE_DIST_MAX;
+
+        if (strcmp(arg, "file") == 0) {
+                d->type = SIZE_DIST_EMPIRICAL;
+                load_empirical(d, colon + 1, cb);
+        } else if (strcmp(arg, "fixed") == 0) {
+                d->type = SIZE_DIST_FIXED;
+                if (parse_params(colon + 1, params, 1, cb) != 1)
+                        LOG_FATAL(cb, "fixed:SIZE expected");
+                d->a = d->max = params[0];
+        } else if (strcmp(arg, "uniform") == 0) {
+                d->type = SIZE_DIST_UNIFORM;
+                if (parse_params(colon + 1, params, 2, cb) != 2)
+                        LOG_FATAL(cb, "uniform:MIN,MAX expected");
+                d->a = params[0];
+                d->max = params[1];
+                if (d->a > d->max)
+                        LOG_FATAL(cb, "uniform: MIN exceeds MAX");
+        } else if (strcmp(arg, "exponential") == 0) {
+                d->type = SIZE_DIST_EXPONENTIAL;
+                n = parse_params(colon + 1, params, 2, cb);
+                if (n < 1)
+                        LOG_FATAL(cb, "exponential:MEAN[,MAX] expected");
+                d->a = params[0];
+                if (n > 1)
+                        d->max = params[1];
+        } else if (strcmp(arg, "lognormal") == 0) {
+                d->type = SIZE_DIST_LOGNORMAL;
+                n = parse_params(colon + 1, params, 3, cb);
+                if (n < 2)
+                        LOG_FATAL(cb, "lognormal:MU,SIGMA[,MAX] expected");
+                d->a = params[0];
+                d->b = params[1];
+                if (n > 2)
+                        d->max = params[2];
+        } else {
+                LOG_FATAL(cb, "unknown size distribution `%s'", arg);
+        }
+        if (d->max < 1)
+                LOG_FATAL(cb, "size distribution `%s' has no positive sizes",
+                          d->spec);
+
+        *(struct size_dist **) out = d;
+}
+
+void print_size_dist(const char *name, const void *var, struct callbacks *cb)
+{
+        const struct size_dist *d = *(struct size_dist * const *) var;
+
+        PRINT(cb, name, "%s", d ? d->spec : "");
+}
+
+static double standard_normal(unsigned short xsubi[3])
+{
+        /* Box-Muller; 1 - erand48() is in (0, 1] */
+        double u = 1 - erand48(xsubi), v = erand48(xsubi);
+
+        return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+int size_dist_sample(const struct size_dist *d, unsigned short xsubi[3])
+{
+        double size = 0, u;
+        int lo, hi;
+
+        switch (d->type) {
+        case SIZE_DIST_FIXED:
+                return d->max;
+        case SIZE_DIST_UNIFORM:
+                size = d->a + erand48(xsubi) * (d->max - d->a + 1);
+                break;
+        case SIZE_DIST_EXPONENTIAL:
+                size = -log(1 - erand48(xsubi)) * d->a;
+                break;
+        case SIZE_DIST_LOGNORMAL:
+                size = exp(d->a + d->b * standard_normal(xsubi));
+                break;
+        case SIZE_DIST_EMPIRICAL:
+                /* first entry whose cumulative probability covers u */
+                u = erand48(xsubi);
+                lo = 0;
+                hi = d->len - 1;
+                while (lo < hi) {
+                        int mid = (lo + hi) / 2;
+
+                        if (d->cdf[mid] > u)
+                                hi = mid;
+                        else
+                                lo = mid + 1;
+                }
+                return d->sizes[lo];
+        }
+        if (size < 1)
+                return 1;
+        if (size > d->max)
+                return d->max;
+        return size;
+}
+
+int size_dist_max(const struct size_dist *d)
+{
+        return d->max;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2016 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NEPER_SIZE_DIST_H
+#define NEPER_SIZE_DIST_H
+
+/*
+ * Message size distributions, given on the command line as one of
+ *
+ *   fixed:SIZE
+ *   uniform:MIN,MAX
+ *   exponential:MEAN[,MAX]
+ *   lognormal:MU,SIGMA[,MAX]      (of the natural log of the size)
+ *   file:PATH                     (empirical CDF, "SIZE PROBABILITY" lines)
+ *
+ * Samples are clamped to [1, MAX]; MAX defaults to SIZE_DIST_MAX for the
+ * unbounded distributions.
+ */
+
+struct callbacks;
+struct size_dist;
+
+#define SIZE_DIST_MAX (1 << 20)
+
+void parse_size_dist(char *arg, void *out, struct callbacks *cb);
+void print_size_dist(const char *name, const void *var, struct callbacks *cb);
+
+/* Draw a size, using the erand48() state @xsubi. */
+int size_dist_sample(const struct size_dist *d, unsigned short xsubi[3]);
+/* Largest size the distribution can return. */
+int size_dist_max(const struct size_dist *d);
+
+#endif
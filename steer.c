@@ -0,0 +1,272 @@
+/*
+ * Copyright 2018 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "steer.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "common.h"
+#include "flow.h"
+#include "lib.h"
+#include "thread.h"
+
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49
+#endif
+
+#ifndef SO_INCOMING_NAPI_ID
+#define SO_INCOMING_NAPI_ID 56
+#endif
+
+/* NAPI IDs remembered, one per RX queue is plenty */
+#define MAX_NAPI_IDS 1024
+
+/* Connections handed to one thread, and its accept counters */
+struct steer_queue {
+        pthread_mutex_t lock;
+        int *fds;
+        int len;
+        int cap;
+        int efd;                /* readable while fds is not empty */
+        struct flow *fl;        /* lite flow wrapping efd */
+        unsigned long accepted;
+        unsigned long located;  /* accepted with a known RX CPU */
+        unsigned long local;    /* ... and handled on it */
+        unsigned long handed;   /* handed over to another thread */
+};
+
+struct steer {
+        struct thread *workers;
+        int n;
+        bool napi;
+        struct steer_queue *queues;
+        pthread_mutex_t napi_lock;
+        unsigned int napi_ids[MAX_NAPI_IDS];
+        int napi_owner[MAX_NAPI_IDS];
+        int n_napi;
+        int next_owner;         /* round robin for unmatched NAPI IDs */
+};
+
+void steer_create(struct thread *workers, int n, struct options *opts,
+                  struct callbacks *cb)
+{
+        struct steer *s;
+        int i;
+
+        s = calloc(1, sizeof(*s));
+        if (!s)
+                PLOG_FATAL(cb, "calloc steer");
+        s->queues = calloc(n, sizeof(*s->queues));
+        if (!s->queues)
+                PLOG_FATAL(cb, "calloc steer queues");
+        s->workers = workers;
+        s->n = n;
+        s->napi = !strcmp(opts->steer_incoming, "napi");
+        pthread_mutex_init(&s->napi_lock, NULL);
+        for (i = 0; i < n; i++) {
+                struct steer_queue *q = &s->queues[i];
+
+                pthread_mutex_init(&q->lock, NULL);
+                q->efd = eventfd(0, EFD_NONBLOCK);
+                if (q->efd == -1)
+                        PLOG_FATAL(cb, "eventfd");
+                workers[i].steer = s;
+        }
+}
+
+void steer_destroy(struct thread *workers)
+{
+        struct steer *s = workers[0].steer;
+        int i, j;
+
+        if (!s)
+                return;
+        for (i = 0; i < s->n; i++) {
+                struct steer_queue *q = &s->queues[i];
+
+                /* handed over too late to be taken */
+                for (j = 0; j < q->len; j++)
+                        do_close(q->fds[j]);
+                free(q->fds);
+                free(q->fl);
+                do_close(q->efd);
+                pthread_mutex_destroy(&q->lock);
+        }
+        pthread_mutex_destroy(&s->napi_lock);
+        free(s->queues);
+        free(s);
+}
+
+void steer_watch(struct thread *t, int epfd)
+{
+        struct steer_queue *q;
+
+        if (!t->steer)
+                return;
+        q = &t->steer->queues[t->index];
+        q->fl = addflow_lite(epfd, q->efd, EPOLLIN, t->cb);
+}
+
+bool steer_is_handoff(struct thread *t, struct flow *flow)
+{
+        return t->steer && flow == t->steer->queues[t->index].fl;
+}
+
+static int sockopt_int(int fd, int optname)
+{
+        socklen_t len = sizeof(int);
+        int val;
+
+        if (getsockopt(fd, SOL_SOCKET, optname, &val, &len))
+                return -1;
+        return val;
+}
+
+/* The worker on @cpu, @t itself if it qualifies, or -1. */
+static int cpu_owner(struct steer *s, struct thread *t, int cpu)
+{
+        int i;
+
+        if (t->cpu == cpu)
+                return t->index;
+        for (i = 0; i < s->n; i++) {
+                if (s->workers[i].cpu == cpu)
+                        return i;
+        }
+        return -1;
+}
+
+/* The worker serving @napi_id. A NAPI ID seen for the first time goes to
+ * the worker on the CPU its first connection came in on, if any, and to
+ * the next worker in turn otherwise. */
+static int napi_owner(struct steer *s, struct thread *t, unsigned int napi_id,
+                      int cpu)
+{
+        int i, owner = -1;
+
+        pthread_mutex_lock(&s->napi_lock);
+        for (i = 0; i < s->n_napi; i++) {
+                if (s->napi_ids[i] == napi_id) {
+                        owner = s->napi_owner[i];
+                        break;
+                }
+        }
+        if (owner < 0 && s->n_napi < MAX_NAPI_IDS) {
+                owner = cpu_owner(s, t, cpu);
+                if (owner < 0)
+                        owner = s->next_owner++ % s->n;
+                s->napi_ids[s->n_napi] = napi_id;
+                s->napi_owner[s->n_napi++] = owner;
+        }
+        pthread_mutex_unlock(&s->napi_lock);
+        return owner;
+}
+
+static void hand_over(struct steer *s, int target, int fd, struct callbacks *cb)
+{
+        struct steer_queue *q = &s->queues[target];
+        uint64_t one = 1;
+        int *fds;
+
+        pthread_mutex_lock(&q->lock);
+        if (q->len == q->cap) {
+                q->cap = q->cap ? q->cap * 2 : 16;
+                fds = realloc(q->fds, q->cap * sizeof(*fds));
+                if (!fds)
+                        PLOG_FATAL(cb, "realloc steer queue");
+                q->fds = fds;
+        }
+        q->fds[q->len++] = fd;
+        pthread_mutex_unlock(&q->lock);
+        if (write(q->efd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+                PLOG_ERROR(cb, "write eventfd");
+}
+
+bool steer_accepted(struct thread *t, int fd)
+{
+        struct steer *s = t->steer;
+        struct steer_queue *q = &s->queues[t->index];
+        int cpu, napi_id, target = -1;
+
+        cpu = sockopt_int(fd, SO_INCOMING_CPU);
+        t->hot->syscalls++;
+        if (s->napi) {
+                napi_id = sockopt_int(fd, SO_INCOMING_NAPI_ID);
+                t->hot->syscalls++;
+                /* 0 for loopback and drivers without busy polling */
+                if (napi_id > 0)
+                        target = napi_owner(s, t, napi_id, cpu);
+        } else if (cpu >= 0) {
+                target = cpu_owner(s, t, cpu);
+        }
+        if (target < 0)
+                target = t->index;
+
+        q->accepted++;
+        if (cpu >= 0) {
+                q->located++;
+                if (s->workers[target].cpu == cpu)
+                        q->local++;
+        }
+        if (target == t->index)
+                return true;
+        q->handed++;
+        hand_over(s, target, fd, t->cb);
+        return false;
+}
+
+int steer_take(struct thread *t)
+{
+        struct steer_queue *q = &t->steer->queues[t->index];
+        uint64_t count;
+        int fd = -1;
+
+        pthread_mutex_lock(&q->lock);
+        if (q->len)
+                fd = q->fds[--q->len];
+        /* reset the eventfd only once the queue is drained */
+        if (!q->len && read(q->efd, &count, sizeof(count)) == -1 &&
+            errno != EAGAIN)
+                PLOG_ERROR(t->cb, "read eventfd");
+        pthread_mutex_unlock(&q->lock);
+        return fd;
+}
+
+void steer_report(struct thread *tinfo)
+{
+        struct steer *s = tinfo[0].steer;
+        struct callbacks *cb = tinfo[0].cb;
+        unsigned long accepted = 0, located = 0, local = 0, handed = 0;
+        int i;
+
+        if (!s)
+                return;
+        for (i = 0; i < s->n; i++) {
+                accepted += s->queues[i].accepted;
+                located += s->queues[i].located;
+                local += s->queues[i].local;
+                handed += s->queues[i].handed;
+        }
+        PRINT(cb, "num_accepted_flows", "%lu", accepted);
+        PRINT(cb, "num_steered_flows", "%lu", handed);
+        if (located)
+                PRINT(cb, "flow_locality_ratio", "%f",
+                      (double) local / located);
+}
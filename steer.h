@@ -0,0 +1,57 @@
+/*
+ * Copyright 2018 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NEPER_STEER_H
+#define NEPER_STEER_H
+
+/*
+ * Flow steering on the server. With SO_REUSEPORT the kernel picks the
+ * thread that accepts a connection by hashing its addresses, which has
+ * nothing to do with the CPU its packets are received on. In steering
+ * mode the accepting thread looks up where the connection is received,
+ * by SO_INCOMING_CPU or SO_INCOMING_NAPI_ID, and hands it over to the
+ * worker pinned to that CPU or serving that NAPI ID.
+ */
+
+#include <stdbool.h>
+
+struct callbacks;
+struct flow;
+struct options;
+struct thread;
+
+/* Set up hand-off between the @n threads @workers and point them at it. */
+void steer_create(struct thread *workers, int n, struct options *opts,
+                  struct callbacks *cb);
+void steer_destroy(struct thread *workers);
+
+/* Have connections handed over to @t wake up its epoll set @epfd. */
+void steer_watch(struct thread *t, int epfd);
+
+/* Whether @flow is the one watched by steer_watch(). */
+bool steer_is_handoff(struct thread *t, struct flow *flow);
+
+/* Decide which thread handles the connection @fd that @t just accepted.
+ * Returns false if it was handed over to another thread, which now owns
+ * @fd, and true if @t should carry on with it. */
+bool steer_accepted(struct thread *t, int fd);
+
+/* Take a connection handed to @t. Returns -1 if there is none left. */
+int steer_take(struct thread *t);
+
+void steer_report(struct thread *tinfo);
+
+#endif
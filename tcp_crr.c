@@ -0,0 +1,344 @@
+/*
+ * Copyright 2018 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * TCP connect/request/response: every transaction runs on a connection of
+ * its own. Client flows keep their identity (and statistics) across
+ * connections, server flows live for a single transaction.
+ */
+
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <time.h>
+#include "common.h"
+#include "flow.h"
+#include "histogram.h"
+#include "interval.h"
+#include "lib.h"
+#include "sample.h"
+#include "thread.h"
+#include "workload.h"
+
+/* Latencies count from the connect() that started the transaction. The
+ * first connection of a flow was made by run_client() before the run
+ * started, its write_time is still zero and it goes unmeasured. */
+static inline void track_latency(struct histogram *lst, struct flow *flow)
+{
+        struct timespec now;
+
+        if (!flow->write_time.tv_sec && !flow->write_time.tv_nsec)
+                return;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        histogram_add(lst, seconds_between(&flow->write_time, &now));
+}
+
+/* A client flow run_client() set up, on its first connection. */
+static void client_flow_init(struct thread *t, struct flow *flow)
+{
+        flow->connect_latency = histogram_create(t->cb);
+        flow->first_byte_latency = histogram_create(t->cb);
+}
+
+/* Start the next transaction of @flow on a new connection. */
+static void client_next(struct thread *t, int epfd, struct flow *flow)
+{
+        struct options *opts = t->opts;
+
+        if (opts->linger_rst)
+                set_linger(flow->fd, 1, 0, t->cb);
+        client_reconnect(t, &tcp_socket_ops, epfd, flow, EPOLLOUT);
+        flow->bytes_to_write = opts->request_size;
+}
+
+/* Called once the socket of @flow turns writable after connect().
+ * Returns false if the connection failed and had to be retried. */
+static bool client_connected(struct thread *t, int epfd, struct flow *flow)
+{
+        struct callbacks *cb = t->cb;
+        socklen_t len = sizeof(int);
+        int err = 0;
+
+        flow->connecting = false;
+        if (getsockopt(flow->fd, SOL_SOCKET, SO_ERROR, &err, &len))
+                err = errno;
+        t->hot->syscalls++;
+        if (err) {
+                /* the server may wind down before we are told to stop */
+                if (err != ECONNREFUSED)
+                        LOG_ERROR(cb, "connect: %s", strerror(err));
+                client_next(t, epfd, flow);
+                return false;
+        }
+        track_latency(flow->connect_latency, flow);
+        return true;
+}
+
+static void client_events(struct thread *t, int epfd,
+                          struct epoll_event *events, int nfds,
+                          int listen_fd, char *buf)
+{
+        struct script_slave *ss = t->script_slave;
+        struct options *opts = t->opts;
+        struct callbacks *cb = t->cb;
+        struct flow *flow;
+        ssize_t num_bytes;
+        int i;
+
+        UNUSED(listen_fd);
+
+        for (i = 0; i < nfds; i++) {
+                flow = events[i].data.ptr;
+                if (flow->fd == t->stop_efd) {
+                        t->stop = 1;
+                        break;
+                }
+                if (events[i].events & EPOLLOUT) {
+                        ssize_t to_write = flow->bytes_to_write;
+                        int flags = 0;
+
+                        if (flow->connecting && !client_connected(t, epfd, flow))
+                                continue;
+                        if (to_write > opts->buffer_size) {
+                                to_write = opts->buffer_size;
+                                flags |= MSG_MORE;
+                        }
+                        num_bytes = do_write(ss, flow->fd, buf, to_write, flags);
+                        t->hot->syscalls++;
+                        if (num_bytes == -1) {
+                                /* TCP_FASTOPEN_CONNECT without a cookie */
+                                if (errno == EINPROGRESS || errno == EAGAIN)
+                                        continue;
+                                PLOG_ERROR(cb, "write");
+                                client_next(t, epfd, flow);
+                                continue;
+                        }
+                        flow->bytes_to_write -= num_bytes;
+                        if (flow->bytes_to_write > 0)
+                                continue;
+                        /* Successfully sent request, now wait for response */
+                        events[i].events = EPOLLRDHUP | EPOLLIN;
+                        epoll_ctl_or_die(epfd, EPOLL_CTL_MOD, flow->fd,
+                                         &events[i], cb);
+                        t->hot->syscalls++;
+                        flow->bytes_to_read = opts->response_size;
+                } else if (events[i].events & EPOLLIN) {
+                        ssize_t to_read = flow->bytes_to_read;
+
+                        if (to_read > opts->buffer_size)
+                                to_read = opts->buffer_size;
+                        num_bytes = do_read(ss, flow->fd, buf, to_read, 0);
+                        t->hot->syscalls++;
+                        if (num_bytes == -1 && errno == EAGAIN)
+                                continue;
+                        if (num_bytes <= 0) {
+                                if (num_bytes == -1 && errno != ECONNRESET)
+                                        PLOG_ERROR(cb, "read");
+                                else if (num_bytes == 0)
+                                        LOG_ERROR(cb, "server closed early");
+                                client_next(t, epfd, flow);
+                                continue;
+                        }
+                        if (flow->bytes_to_read == opts->response_size)
+                                track_latency(flow->first_byte_latency, flow);
+                        flow->bytes_read += num_bytes;
+                        flow->bytes_to_read -= num_bytes;
+                        if (flow->bytes_to_read > 0)
+                                continue;
+                        t->hot->transactions++;
+                        flow->transactions++;
+                        track_latency(flow->latency, flow);
+                        interval_collect(flow, t);
+                        client_next(t, epfd, flow);
+                } else if (events[i].events & (EPOLLRDHUP | EPOLLERR)) {
+                        LOG_ERROR(cb, "connection lost");
+                        client_next(t, epfd, flow);
+                }
+        }
+}
+
+/**
+ * Accepts one connection on @listen_fl. Connections don't get an interval
+ * or a latency histogram of their own, the listening flow samples the
+ * completed transactions of the whole thread instead. This keeps the
+ * server's memory footprint flat no matter how many connections it churns
+ * through, and keeps the per-connection path free of logging.
+ */
+static void server_accept(struct flow *listen_fl, int epfd, struct thread *t)
+{
+        struct options *opts = t->opts;
+        struct callbacks *cb = t->cb;
+        struct flow *flow;
+        int client;
+
+        listen_fl->transactions = t->hot->transactions;
+        interval_collect(listen_fl, t);
+
+        client = accept(listen_fl->fd, NULL, NULL);
+        t->hot->syscalls++;
+        if (client == -1) {
+                if (errno == EINTR || errno == ECONNABORTED ||
+                    errno == EAGAIN)
+                        return;
+                PLOG_ERROR(cb, "accept");
+                return;
+        }
+        t->hot->accepts++;
+        setup_connected_socket(client, opts, cb);
+
+        flow = addflow_oneshot(epfd, client, t->hot->next_flow_id++,
+                               EPOLLIN, cb);
+        t->hot->syscalls += 2;       /* fcntl(), epoll_ctl() */
+        flow->bytes_to_read = opts->request_size;
+}
+
+static void server_events(struct thread *t, int epfd,
+                          struct epoll_event *events, int nfds, int fd_listen,
+                          char *buf)
+{
+        struct script_slave *ss = t->script_slave;
+        struct options *opts = t->opts;
+        struct callbacks *cb = t->cb;
+        ssize_t num_bytes;
+        int i;
+
+        for (i = 0; i < nfds; i++) {
+                struct flow *flow = events[i].data.ptr;
+                if (flow->fd == t->stop_efd) {
+                        t->stop = 1;
+                        break;
+                }
+                if (flow->fd == fd_listen) {
+                        server_accept(flow, epfd, t);
+                        continue;
+                }
+                if (events[i].events & EPOLLIN && flow->bytes_to_read) {
+                        ssize_t to_read = flow->bytes_to_read;
+
+                        if (to_read > opts->buffer_size)
+                                to_read = opts->buffer_size;
+                        num_bytes = do_read(ss, flow->fd, buf, to_read, 0);
+                        t->hot->syscalls++;
+                        if (num_bytes == -1 && errno == EAGAIN)
+                                continue;
+                        if (num_bytes <= 0) {
+                                /* client went away, e.g. reset on close */
+                                delflow_oneshot(flow);
+                                continue;
+                        }
+                        flow->bytes_read += num_bytes;
+                        flow->bytes_to_read -= num_bytes;
+                        if (flow->bytes_to_read > 0)
+                                continue;
+                        /* Successfully read request, now send a response */
+                        events[i].events = EPOLLRDHUP | EPOLLOUT;
+                        epoll_ctl_or_die(epfd, EPOLL_CTL_MOD, flow->fd,
+                                         &events[i], cb);
+                        t->hot->syscalls++;
+                        flow->bytes_to_write = opts->response_size;
+                } else if (events[i].events & EPOLLOUT) {
+                        ssize_t to_write = flow->bytes_to_write;
+                        int flags = 0;
+
+                        if (to_write > opts->buffer_size) {
+                                to_write = opts->buffer_size;
+                                flags |= MSG_MORE;
+                        }
+                        num_bytes = do_write(ss, flow->fd, buf, to_write, flags);
+                        t->hot->syscalls++;
+                        if (num_bytes == -1) {
+                                if (errno != EAGAIN)
+                                        delflow_oneshot(flow);
+                                continue;
+                        }
+                        flow->bytes_to_write -= num_bytes;
+                        if (flow->bytes_to_write > 0)
+                                continue;
+                        t->hot->transactions++;
+                        flow->transactions++;
+                        /* Response sent, wait for the client to close */
+                        events[i].events = EPOLLRDHUP | EPOLLIN;
+                        epoll_ctl_or_die(epfd, EPOLL_CTL_MOD, flow->fd,
+                                         &events[i], cb);
+                        t->hot->syscalls++;
+                } else {
+                        /* EOF, hang-up or error once the response is out */
+                        delflow_oneshot(flow);
+                }
+        }
+}
+
+static const struct loop_hooks client_hooks = {
+        .flow_init = client_flow_init,
+};
+
+static void *thread_start(void *arg)
+{
+        struct thread *t = arg;
+        reset_port(t->ai, atoi(t->opts->port), t->cb);
+        if (t->opts->client)
+                run_client(t, &tcp_socket_ops, client_events, &client_hooks);
+        else
+                run_server(t, &tcp_socket_ops, server_events, NULL);
+        return NULL;
+}
+
+static void report_stats(struct thread *tinfo)
+{
+        struct options *opts = tinfo[0].opts;
+        struct callbacks *cb = tinfo[0].cb;
+        struct histogram *connect_all, *first_byte_all;
+        unsigned long connections = 0, connect_errors = 0;
+        double duration = run_duration(tinfo);
+        struct sample_store *st;
+        int i;
+
+        for (i = 0; i < opts->num_threads; i++) {
+                connections += tinfo[i].hot->transactions;
+                connect_errors += tinfo[i].hot->connect_errors;
+        }
+        PRINT(cb, "num_connections", "%lu", connections);
+        if (duration > 0)
+                PRINT(cb, "connection_rate", "%.2f", connections / duration);
+
+        if (opts->client) {
+                PRINT(cb, "num_connect_errors", "%lu", connect_errors);
+                connect_all = histogram_create(cb);
+                first_byte_all = histogram_create(cb);
+                for (i = 0; i < opts->num_threads; i++) {
+                        st = tinfo[i].samples;
+                        if (!st->connect_latency)
+                                continue;
+                        histogram_merge(connect_all, st->connect_latency);
+                        histogram_merge(first_byte_all,
+                                        st->first_byte_latency);
+                }
+                if (histogram_count(connect_all))
+                        report_latency("connect_latency", connect_all,
+                                       opts, cb);
+                if (histogram_count(first_byte_all))
+                        report_latency("first_byte_latency",
+                                       first_byte_all, opts, cb);
+                histogram_destroy(connect_all);
+                histogram_destroy(first_byte_all);
+        }
+
+        report_rr_stats(tinfo);
+}
+
+int tcp_crr(struct options *opts, struct callbacks *cb)
+{
+        return run_main_thread(opts, cb, thread_start, report_stats);
+}